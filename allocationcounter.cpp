@@ -0,0 +1,36 @@
+#include "allocationcounter.hpp"
+
+#ifdef COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+static thread_local long long allocations = 0;
+
+void *operator new(std::size_t size) {
+	++ allocations;
+	void *p = std::malloc(size != 0 ? size : 1);
+	if(p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+#endif
+
+bool AllocationCounter::isEnabled() {
+#ifdef COUNT_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+long long AllocationCounter::get() {
+#ifdef COUNT_ALLOCATIONS
+	return allocations;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+//Counts the heap allocations (calls of operator new) of each thread.
+//It replaces the global operator new, so it is compiled in only with -DCOUNT_ALLOCATIONS (make alloc).
+class AllocationCounter {
+public:
+	static bool isEnabled();
+	//number of allocations made by the calling thread so far (always 0 unless enabled)
+	static long long get();
+};
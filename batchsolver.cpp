@@ -0,0 +1,227 @@
+#include "batchsolver.hpp"
+#include "fastgrid.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+BatchSolver::BatchSolver() {
+	FastGrid::initMasks();
+	rep(l, Lanes)
+		clearLane(l);
+}
+
+//Lanes step together, so that the loops over l are vectorized. The conditions are turned into masks (~0 or 0) for that.
+void BatchSolver::propagate(unsigned &progress, unsigned &invalid) {
+	const uint64_t *mask81 = FastGrid::mask81.data;
+	alignas(64) uint64_t ones[2][Lanes] = {}, twos[2][Lanes] = {}, assignedAll[2][Lanes] = {};
+	rep(d, 9) rep(w, 2) rep(l, Lanes) {
+		uint64_t x = _candidates[d][w][l];
+		twos[w][l] |= ones[w][l] & x;
+		ones[w][l] |= x;
+		assignedAll[w][l] |= _assigned[d][w][l];
+	}
+
+	//naked singles, hidden singles, and the units where a digit can no longer be placed
+	alignas(64) uint64_t found[9][2][Lanes];
+	alignas(64) uint64_t failed[Lanes] = {};
+	rep(d, 9) rep(w, 2) rep(l, Lanes)
+		found[d][w][l] = _candidates[d][w][l] & ones[w][l] & ~twos[w][l];
+	rep(d, 9) rep(unit, 27) {
+		uint64_t u0 = FastGrid::unitMasks[unit].data[0], u1 = FastGrid::unitMasks[unit].data[1];
+		rep(l, Lanes) {
+			uint64_t t0 = _candidates[d][0][l] & u0, t1 = _candidates[d][1][l] & u1;
+			bool none = (t0 | t1) == 0;
+			bool single = !none && (t0 & (t0 - 1)) == 0 && (t1 & (t1 - 1)) == 0 && (t0 == 0 || t1 == 0);
+			uint64_t singleMask = single ? ~uint64_t(0) : 0;
+			found[d][0][l] |= t0 & singleMask;
+			found[d][1][l] |= t1 & singleMask;
+			bool placed = ((_assigned[d][0][l] & u0) | (_assigned[d][1][l] & u1)) != 0;
+			failed[l] |= none && !placed ? 1 : 0;
+		}
+	}
+
+	//a cell found for two digits, or a cell without candidates
+	alignas(64) uint64_t any[2][Lanes] = {};
+	rep(d, 9) rep(w, 2) rep(l, Lanes) {
+		failed[l] |= any[w][l] & found[d][w][l];
+		any[w][l] |= found[d][w][l];
+	}
+	rep(w, 2) rep(l, Lanes)
+		failed[l] |= mask81[w] & ~assignedAll[w][l] & ~ones[w][l];
+
+	//assigns the digits found. Two cells of a unit found for the same digit fail.
+	rep(d, 9) rep(unit, 27) {
+		uint64_t u0 = FastGrid::unitMasks[unit].data[0], u1 = FastGrid::unitMasks[unit].data[1];
+		rep(l, Lanes) {
+			uint64_t t0 = found[d][0][l] & u0, t1 = found[d][1][l] & u1;
+			failed[l] |= (t0 & (t0 - 1)) | (t1 & (t1 - 1)) | (t0 != 0 && t1 != 0 ? 1 : 0);
+			uint64_t hit = (t0 | t1) != 0 ? ~uint64_t(0) : 0;
+			_candidates[d][0][l] &= ~(u0 & hit);
+			_candidates[d][1][l] &= ~(u1 & hit);
+		}
+	}
+	rep(d, 9) rep(w, 2) rep(l, Lanes) {
+		_candidates[d][w][l] &= ~any[w][l];
+		_assigned[d][w][l] |= found[d][w][l];
+	}
+
+	progress = invalid = 0;
+	rep(l, Lanes) {
+		if((any[0][l] | any[1][l]) != 0)
+			progress |= 1U << l;
+		if(failed[l] != 0)
+			invalid |= 1U << l;
+	}
+}
+
+//as if solved, so that the lane does nothing
+void BatchSolver::clearLane(int l) {
+	rep(d, 9) rep(w, 2) {
+		_candidates[d][w][l] = 0;
+		_assigned[d][w][l] = d == 0 ? FastGrid::mask81.data[w] : 0;
+	}
+	_lanes[l].problem = -1;
+	_lanes[l].stack.clear();
+}
+
+bool BatchSolver::loadLane(int l, const char *problem) {
+	rep(d, 9) rep(w, 2) {
+		_candidates[d][w][l] = FastGrid::mask81.data[w];
+		_assigned[d][w][l] = 0;
+	}
+	_lanes[l].count = 0;
+	_lanes[l].stack.clear();
+	rep(cell, 81) {
+		int c = problem[cell];
+		if(c < '1' || '9' < c)
+			continue;
+		int digit = c - '1';
+		if((_candidates[digit][cell / 64][l] >> (cell % 64) & 1) == 0)
+			return false;
+		assignInLane(l, cell, digit);
+	}
+	return true;
+}
+
+//same as FastGrid::assign
+void BatchSolver::assignInLane(int l, int cell, int digit) {
+	rep(w, 2)
+		_candidates[digit][w][l] &= FastGrid::nonadjacencyMasks[cell].data[w];
+	uint64_t bit = uint64_t(1) << (cell % 64);
+	rep(d, 9)
+		_candidates[d][cell / 64][l] &= ~bit;
+	_assigned[digit][cell / 64][l] |= bit;
+}
+
+bool BatchSolver::isLaneSolved(int l) const {
+	rep(w, 2) {
+		uint64_t assigned = 0;
+		rep(d, 9)
+			assigned |= _assigned[d][w][l];
+		if(assigned != FastGrid::mask81.data[w])
+			return false;
+	}
+	return true;
+}
+
+string BatchSolver::getLaneSolution(int l) const {
+	string solution(81, '0');
+	rep(d, 9) rep(w, 2) {
+		for(int bit : EachBit64(_assigned[d][w][l]))
+			solution[w * 64 + bit] = (char)('1' + d);
+	}
+	return solution;
+}
+
+void BatchSolver::saveLane(int l, Frame &frame) const {
+	rep(d, 9) rep(w, 2) {
+		frame.candidates[d][w] = _candidates[d][w][l];
+		frame.assigned[d][w] = _assigned[d][w][l];
+	}
+}
+
+void BatchSolver::restoreLane(int l, const Frame &frame) {
+	rep(d, 9) rep(w, 2) {
+		_candidates[d][w][l] = frame.candidates[d][w];
+		_assigned[d][w][l] = frame.assigned[d][w];
+	}
+}
+
+//takes the next guess left on the stack
+bool BatchSolver::backtrack(int l) {
+	vector<Frame> &stack = _lanes[l].stack;
+	if(stack.empty())
+		return false;
+	Frame &frame = stack.back();
+	restoreLane(l, frame);
+	pair<int, int> p = frame.tuple[frame.next ++];
+	if(frame.next == frame.size)
+		stack.pop_back();
+	assignInLane(l, p.first, p.second);
+	return true;
+}
+
+//the same tuple as UniquenessChecker would guess
+void BatchSolver::guess(int l) {
+	UniquenessChecker::CheckState state;
+	rep(d, 9) rep(w, 2)
+		state.grid.digitMasks[d].data[w] = _candidates[d][w][l];
+	vector<Frame> &stack = _lanes[l].stack;
+	stack.emplace_back();
+	Frame &frame = stack.back();
+	frame.size = UniquenessChecker::findMinTuple(state, frame.tuple);
+	frame.next = 1;
+	saveLane(l, frame);
+	pair<int, int> p = frame.tuple[0];
+	assignInLane(l, p.first, p.second);
+}
+
+void BatchSolver::solve(const vector<string> &problems, long long limit, vector<long long> &counts, vector<string> &solutions) {
+	int numProblems = (int)problems.size();
+	counts.assign(numProblems, 0);
+	solutions.assign(numProblems, string(81, '0'));
+	int nextProblem = 0;
+	unsigned active = 0;
+	//loads the next problem that is not invalid from the start
+	auto startLane = [&](int l) {
+		while(nextProblem < numProblems) {
+			int problem = nextProblem ++;
+			if(loadLane(l, problems[problem].c_str())) {
+				_lanes[l].problem = problem;
+				active |= 1U << l;
+				return;
+			}
+		}
+		clearLane(l);
+		active &= ~(1U << l);
+	};
+	auto finishLane = [&](int l) {
+		counts[_lanes[l].problem] = _lanes[l].count;
+		startLane(l);
+	};
+
+	rep(l, Lanes)
+		startLane(l);
+	while(active != 0) {
+		unsigned progress, invalid;
+		propagate(progress, invalid);
+		for(int l : EachBit(active)) {
+			if(invalid >> l & 1) {
+				if(!backtrack(l))
+					finishLane(l);
+			} else if(progress >> l & 1) {
+				continue;
+			} else if(isLaneSolved(l)) {
+				Lane &lane = _lanes[l];
+				if(lane.count ++ == 0)
+					solutions[lane.problem] = getLaneSolution(l);
+				if(lane.count >= limit || !backtrack(l))
+					finishLane(l);
+			} else {
+				guess(l);
+			}
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "uniquenesschecker.hpp"
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+
+//Solves many problems at once, one per lane, on the digit planes of FastGrid.
+//The lanes run their searches independently, but take the steps of propagation (naked and hidden singles)
+//together: each step is a loop over the lanes, which the compiler vectorizes (AVX2 / AVX-512 with -march=native).
+//A lane that cannot make progress guesses or backtracks by itself, and takes the next problem when done.
+class BatchSolver {
+public:
+	enum { Lanes = 8 };
+
+	BatchSolver();
+
+	//counts[i]: the number of solutions of problems[i], or limit if there are limit or more.
+	//solutions[i]: the first solution found of problems[i] (all '0' if none).
+	void solve(const std::vector<std::string> &problems, long long limit, std::vector<long long> &counts, std::vector<std::string> &solutions);
+
+private:
+	//the state of a lane saved for backtracking, with the guesses left
+	struct Frame {
+		uint64_t candidates[9][2];
+		uint64_t assigned[9][2];
+		std::pair<int, int> tuple[9];
+		int size;
+		int next;
+	};
+
+	struct Lane {
+		int problem;
+		long long count;
+		std::vector<Frame> stack;
+	};
+
+	//one step of propagation in all the lanes. Sets the lanes that assigned digits and those found invalid (bit l for lane l).
+	void propagate(unsigned &progress, unsigned &invalid);
+
+	bool loadLane(int l, const char *problem);
+	void clearLane(int l);
+	void assignInLane(int l, int cell, int digit);
+	bool isLaneSolved(int l) const;
+	std::string getLaneSolution(int l) const;
+	void saveLane(int l, Frame &frame) const;
+	void restoreLane(int l, const Frame &frame);
+	//false if there is nothing to backtrack to
+	bool backtrack(int l);
+	void guess(int l);
+
+	//candidates[d][w][l]: word w of the cells where d is a candidate in lane l (unassigned cells only, as in FastGrid).
+	//assigned[d][w][l]: the cells assigned d.
+	alignas(64) uint64_t _candidates[9][2][Lanes];
+	alignas(64) uint64_t _assigned[9][2][Lanes];
+	Lane _lanes[Lanes];
+};
@@ -26,13 +26,20 @@ void Combiner::combineAllMultithreaded(const vector<Mask81>& hintMasks, const ve
 	_infoLogger->log("building row permutation diagram...");
 	rowPermutationDiagram.buildDiagramForMasks(hintMasks, _infoLogger.get());
 
+	initSharedMemo();
+
 	if(_numWorkers == 1) {
 		thread main([&]() {
 			combineAllMain(hintMasks, solutions, initKnownProblems);
 		});
 		SearchWorker worker(0, hintMasks, &rowPermutationDiagram, _config, *_workQueue, *_responceQueue, *_infoLogger);
+		if(_config.sharedMemo)
+			worker.shareMemo(&_raterMemo, &_fastRaterMemo);
+		worker.setRatingStore(_ratingStore);
 		worker.run();
 		main.join();
+		logSharedMemoStats();
+		logRatingStoreStats();
 		return;
 	}
 
@@ -40,17 +47,45 @@ void Combiner::combineAllMultithreaded(const vector<Mask81>& hintMasks, const ve
 	vector<thread> workerThreads(_numWorkers);
 	rep(i, _numWorkers) {
 		workers[i].reset(new SearchWorker(i + 1, hintMasks, &rowPermutationDiagram, _config, *_workQueue, *_responceQueue, *_infoLogger));
+		if(_config.sharedMemo)
+			workers[i]->shareMemo(&_raterMemo, &_fastRaterMemo);
+		workers[i]->setRatingStore(_ratingStore);
 		workerThreads[i] = thread([&workers, i]() {
 			return workers[i]->run();
 		});
 	}
 
 	combineAllMain(hintMasks, solutions, initKnownProblems);
+	logSharedMemoStats();
+	logRatingStoreStats();
 
 	rep(i, _numWorkers)
 		workerThreads[i].detach();
 }
 
+//one table as large as the private tables of all the workers
+void Combiner::initSharedMemo() {
+	if(!_config.sharedMemo)
+		return;
+	if(_config.fastRater)
+		_fastRaterMemo.init((size_t)_config.memoSize * _numWorkers);
+	else
+		_raterMemo.init((size_t)_config.memoSize * _numWorkers);
+}
+
+void Combiner::logSharedMemoStats() {
+	if(!_config.sharedMemo)
+		return;
+	MemoTableStats stats = _config.fastRater ? _fastRaterMemo.getStats() : _raterMemo.getStats();
+	_infoLogger->log("shared memo: ", stats.toString());
+}
+
+void Combiner::logRatingStoreStats() {
+	if(_ratingStore == nullptr)
+		return;
+	_infoLogger->log("rating store: ", _ratingStore->getServed(), " served, ", _ratingStore->getAdded(), " added, ", _ratingStore->size(), " ratings");
+}
+
 void Combiner::combineAllMPI(const vector<Mask81>& hintMasks, const vector<string>& solutions, const vector<string>& initKnownProblems) {
 #ifndef ENABLE_MPI
 	VALUE_IS_UNUSED(hintMasks);
@@ -102,8 +137,8 @@ void Combiner::combineAllMain(const vector<Mask81> &hintMasks, const vector<stri
 		case ResponceMessage::Type::FoundProblem:
 			if(knownProblemSet.emplace(message.problem).second) {
 				if(_config.verboseness >= 1)
-					resultLogger.log(message.problem, " ", message.rate);
-				_infoLogger->log(message.problem, ": ", Rater::squash(message.rate), "s");
+					resultLogger.log(message.problem, " ", message.rate, message.isLowerBound ? "+" : "");
+				_infoLogger->log(message.problem, ": ", Rater::squash(message.rate), message.isLowerBound ? "s+" : "s");
 			} else {
 				if(_config.verboseness >= 2)
 					_infoLogger->log(message.problem, " is already known");
@@ -10,13 +10,19 @@
 class Combiner {
 public:
 	Combiner(std::string outputFileName, int numWorkers, const WorkerConfig &config) :
-		_outputFileName(outputFileName), _numWorkers(numWorkers), _config(config) { }
+		_outputFileName(outputFileName), _numWorkers(numWorkers), _config(config), _ratingStore(nullptr) { }
+
+	//shared by the workers (multithreaded only)
+	void setRatingStore(RatingStore *store) { _ratingStore = store; }
 
 	void combineAllMultithreaded(const std::vector<Mask81> &hintMasks, const std::vector<std::string> &solutions, const std::vector<std::string> &initKnownProblems);
 	void combineAllMPI(const std::vector<Mask81> &hintMasks, const std::vector<std::string> &solutions, const std::vector<std::string> &initKnownProblems);
 
 private:
 	void combineAllMain(const std::vector<Mask81> &hintMasks, const std::vector<std::string> &solutions, const std::vector<std::string> &initKnownProblems);
+	void initSharedMemo();
+	void logSharedMemoStats();
+	void logRatingStoreStats();
 
 	std::string _outputFileName;
 	int _numWorkers;
@@ -26,4 +32,8 @@ private:
 	std::unique_ptr<Logger> _infoLogger;
 	WorkQueueInterface *_workQueue;
 	ResponceQueueInterface *_responceQueue;
+	//for config.sharedMemo (multithreaded only)
+	Rater::SharedMemo _raterMemo;
+	FastRater::SharedMemo _fastRaterMemo;
+	RatingStore *_ratingStore;
 };
@@ -9,10 +9,12 @@
 #include "mpiresponcequeue.hpp"
 #include "searchworker.hpp"
 #include "loadlist.hpp"
+#include "ratingstore.hpp"
 #include <unordered_set>
 #include <fstream>
 #include <iostream>
 #include <thread>
+#include <memory>
 
 using namespace utilforcommands;
 using namespace std;
@@ -42,10 +44,15 @@ static void syncData(vector<Mask81> &hintMasks, WorkerConfig &config) {
 	bcast(&config.digitCountBounds.second, MPI_INT);
 	bcast(&config.verboseness, MPI_INT);
 	bcast(&config.randomSolution, MPI_INT);
+	bcast(&config.fastRater, MPI_INT);
+	bcast(&config.boundedRating, MPI_INT);
+	bcast(&config.sharedMemo, MPI_INT);
+	bcast(&config.memoWays, MPI_INT);
+	bcast(&config.lockedCandidates, MPI_INT);
 #endif
 }
 
-static int combineForManagerProcess(const string &maskListFilename, const string &solutionListFilename, const string &outputFilename, WorkerConfig config, int workers) {
+static int combineForManagerProcess(const string &maskListFilename, const string &solutionListFilename, const string &outputFilename, const string &storeFilename, WorkerConfig config, int workers, bool useFastSolver, bool useBatchSolver) {
 	string maskListCacheFilename = "masks_reduced.txt";
 	string solutionListCacheFilename = "solutions_reduced.txt";
 	string knownProblemListCacheFilename = "problems_reduced.txt";
@@ -56,9 +63,14 @@ static int combineForManagerProcess(const string &maskListFilename, const string
 
 	loadHintMasks(maskListFilename, maskListCacheFilename, hintMasks);
 	if(!config.randomSolution)
-		loadSolutions(solutionListFilename, solutionListCacheFilename, knownProblemListCacheFilename, solutions, knownProblemSet);
+		loadSolutions(solutionListFilename, solutionListCacheFilename, knownProblemListCacheFilename, solutions, knownProblemSet, useFastSolver, useBatchSolver);
 
 	Combiner combiner(outputFilename, workers, config);
+	unique_ptr<RatingStore> store;
+	if(!storeFilename.empty()) {
+		store.reset(new RatingStore(storeFilename));
+		combiner.setRatingStore(store.get());
+	}
 	vector<string> knownProblems(knownProblemSet.begin(), knownProblemSet.end());
 	if(!isMPIEnabled()) {
 		combiner.combineAllMultithreaded(hintMasks, solutions, knownProblems);
@@ -93,7 +105,7 @@ static int combineForWorkerProcess(int myRank) {
 int commandCombine(const vector<string> &positional, const unordered_map<string, string> &arguments) {
 	checkArgument(positional.size() == 1);
 
-	string maskListFilename, solutionListFilename, outputFilename;
+	string maskListFilename, solutionListFilename, outputFilename, storeFilename;
 	int rateThreshold = 1000;
 	int uaSize = 14;
 	int memoSize = 100000;
@@ -101,6 +113,13 @@ int commandCombine(const vector<string> &positional, const unordered_map<string,
 	int digitCountLowerBound = 0;
 	int digitCountUpperBound = 81;
 	int verboseness = 10;
+	bool fastRater = false;
+	bool boundedRating = false;
+	bool sharedMemo = false;
+	int memoWays = 1;
+	bool lockedCandidates = false;
+	bool useFastSolver = false;
+	bool useBatchSolver = false;
 	for(const auto &p : arguments) {
 		if(p.first == "problems") {
 			checkArgument(maskListFilename.empty(), "duplicated arguments: --masks and --problems");
@@ -118,6 +137,9 @@ int commandCombine(const vector<string> &positional, const unordered_map<string,
 			memoSize = parseInt(p.second, 0, 10000000);
 		} else if(p.first == "output") {
 			outputFilename = p.second;
+		} else if(p.first == "store") {
+			checkArgument(!p.second.empty());
+			storeFilename = p.second;
 		} else if(p.first == "workers") {
 			workers = parseInt(p.second, 0, 100000);
 		} else if(p.first == "dclb") {
@@ -126,6 +148,26 @@ int commandCombine(const vector<string> &positional, const unordered_map<string,
 			digitCountUpperBound = parseInt(p.second, 0, 81);
 		} else if(p.first == "verboseness") {
 			verboseness = parseInt(p.second, 0, 99);
+		} else if(p.first == "fastrater") {
+			checkArgument(p.second.empty());
+			fastRater = true;
+		} else if(p.first == "bounded") {
+			checkArgument(p.second.empty());
+			boundedRating = true;
+		} else if(p.first == "sharedmemo") {
+			checkArgument(p.second.empty());
+			sharedMemo = true;
+		} else if(p.first == "memoways") {
+			memoWays = parseInt(p.second, 1, 64);
+		} else if(p.first == "lockedcandidates") {
+			checkArgument(p.second.empty());
+			lockedCandidates = true;
+		} else if(p.first == "fastsolver") {
+			checkArgument(p.second.empty());
+			useFastSolver = true;
+		} else if(p.first == "batchsolver") {
+			checkArgument(p.second.empty());
+			useBatchSolver = true;
 		} else {
 			checkArgument(false);
 		}
@@ -147,6 +189,9 @@ int commandCombine(const vector<string> &positional, const unordered_map<string,
 	checkArgument(!maskListFilename.empty(), "use --masks=filename or --problems=filename");
 	checkArgument(!solutionListFilename.empty(), "use --solutions=filename or --problems=filename");
 	checkArgument(!outputFilename.empty(), "use --output=filename");
+	checkArgument(storeFilename.empty() || !isMPIEnabled(), "--store is not supported with MPI");
+	checkArgument(!sharedMemo || !isMPIEnabled(), "--sharedmemo is not supported with MPI (the processes do not share memory)");
+	checkArgument(!useFastSolver || !useBatchSolver, "--fastsolver and --batchsolver cannot be used together");
 
 	if(!isMPIEnabled() || getMPIRank() == 0) {
 		WorkerConfig config;
@@ -156,7 +201,12 @@ int commandCombine(const vector<string> &positional, const unordered_map<string,
 		config.digitCountBounds = { digitCountLowerBound, digitCountUpperBound };
 		config.verboseness = verboseness;
 		config.randomSolution = solutionListFilename == "RANDOM";
-		return combineForManagerProcess(maskListFilename, solutionListFilename, outputFilename, config, workers);
+		config.fastRater = fastRater;
+		config.boundedRating = boundedRating;
+		config.sharedMemo = sharedMemo;
+		config.memoWays = memoWays;
+		config.lockedCandidates = lockedCandidates;
+		return combineForManagerProcess(maskListFilename, solutionListFilename, outputFilename, storeFilename, config, workers, useFastSolver, useBatchSolver);
 	} else {
 		return combineForWorkerProcess(getMPIRank());
 	}
@@ -2,7 +2,13 @@
 #include "mpisupport.hpp"
 #include "util.hpp"
 #include "rater.hpp"
+#include "fastrater.hpp"
 #include "solver.hpp"
+#include "fastsolver.hpp"
+#include "solutionenumerator.hpp"
+#include "batchsolver.hpp"
+#include "dlxsolver.hpp"
+#include "interleavedchecker.hpp"
 #include "uafinder.hpp"
 #include "symmetry.hpp"
 #include "symmetrysearcher.hpp"
@@ -13,6 +19,8 @@
 #include "subsetsearcher.hpp"
 #include "fixingsymmetries.hpp"
 #include "fullsearcher.hpp"
+#include "ratingstore.hpp"
+#include "allocationcounter.hpp"
 
 #include <vector>
 #include <string>
@@ -32,6 +40,7 @@
 #include <mutex>
 #include <cassert>
 #include <queue>
+#include <chrono>
 
 #if defined(_WIN32) && !defined(_WINDOWS_)
 struct FILETIME {
@@ -82,19 +91,163 @@ int commandRate(const vector<string> &positional, const unordered_map<string, st
 	checkArgument(positional.size() == 1);
 	int memoSize = 100000;
 	bool nocheck = false;
+	bool useFastRater = false;
 	int threads = 1;
+	int intraThreads = 1;
+	bool sharedMemo = false;
+	int memoWays = 1;
+	bool memoStats = false;
+	bool countAllocations = false;
+	bool undoTrail = false;
+	bool profile = false;
+	bool useFastSolver = false;
+	bool useBatchSolver = false;
+	string storeFilename;
+	long long threshold = numeric_limits<long long>::max();
 	for(const auto &p : arguments) {
 		if(p.first == "memosize") {
 			memoSize = parseInt(p.second, 0, 10000000);
-		} if(p.first == "nocheck") {
+		} else if(p.first == "store") {
+			checkArgument(!p.second.empty());
+			storeFilename = p.second;
+		} else if(p.first == "threshold") {
+			threshold = parseInt(p.second, 0, numeric_limits<int>::max());
+		} else if(p.first == "nocheck") {
 			checkArgument(p.second.empty());
 			nocheck = true;
+		} else if(p.first == "fastrater") {
+			checkArgument(p.second.empty());
+			useFastRater = true;
 		} else if(p.first == "threads") {
 			threads = parseInt(p.second, 1, 1024);
+		} else if(p.first == "intra-threads") {
+			intraThreads = parseInt(p.second, 1, 1024);
+		} else if(p.first == "sharedmemo") {
+			checkArgument(p.second.empty());
+			sharedMemo = true;
+		} else if(p.first == "memoways") {
+			memoWays = parseInt(p.second, 1, 64);
+		} else if(p.first == "memostats") {
+			checkArgument(p.second.empty());
+			memoStats = true;
+		} else if(p.first == "allocations") {
+			checkArgument(p.second.empty());
+			checkArgument(AllocationCounter::isEnabled(), "--allocations needs a build with -DCOUNT_ALLOCATIONS (make alloc)");
+			countAllocations = true;
+		} else if(p.first == "undotrail") {
+			checkArgument(p.second.empty());
+			undoTrail = true;
+		} else if(p.first == "profile") {
+			checkArgument(p.second.empty());
+			profile = true;
+		} else if(p.first == "fastsolver") {
+			checkArgument(p.second.empty());
+			useFastSolver = true;
+		} else if(p.first == "batchsolver") {
+			checkArgument(p.second.empty());
+			useBatchSolver = true;
 		} else {
 			checkArgument(false);
 		}
 	}
+	checkArgument(!useFastSolver || !useBatchSolver, "--fastsolver and --batchsolver cannot be used together");
+	checkArgument(!useFastRater || intraThreads == 1, "--intra-threads is not supported with --fastrater");
+	checkArgument(!countAllocations || threads == 1, "--allocations is not supported with --threads");
+	checkArgument(!useFastRater || !undoTrail, "--undotrail is not supported with --fastrater");
+	checkArgument(!useFastRater || !profile, "--profile is not supported with --fastrater");
+	//with --sharedmemo, all the raters use one table as large as all their private tables
+	Rater::SharedMemo raterMemo;
+	FastRater::SharedMemo fastRaterMemo;
+	if(sharedMemo) {
+		if(useFastRater)
+			fastRaterMemo.init((size_t)memoSize * threads);
+		else
+			raterMemo.init((size_t)memoSize * threads * intraThreads);
+	}
+	auto shareMemo = [sharedMemo, &raterMemo, &fastRaterMemo](Rater &rater, FastRater &fastRater) {
+		if(sharedMemo) {
+			rater.shareMemo(&raterMemo);
+			fastRater.shareMemo(&fastRaterMemo);
+		}
+	};
+	MemoTableStats privateMemoStats;
+	mutex memoStatsMutex;
+	auto addMemoStats = [useFastRater, &privateMemoStats, &memoStatsMutex](Rater &rater, FastRater &fastRater) {
+		lock_guard<mutex> lock(memoStatsMutex);
+		privateMemoStats.add(useFastRater ? fastRater.getMemoStats() : rater.getMemoStats());
+	};
+	auto printMemoStats = [sharedMemo, memoStats, useFastRater, &raterMemo, &fastRaterMemo, &privateMemoStats]() {
+		if(sharedMemo)
+			cerr << "shared memo: " << (useFastRater ? fastRaterMemo.getStats() : raterMemo.getStats()).toString() << endl;
+		else if(memoStats)
+			cerr << "memo: " << privateMemoStats.toString() << endl;
+	};
+	unique_ptr<RatingStore> store;
+	if(!storeFilename.empty())
+		store.reset(new RatingStore(storeFilename));
+	//With --store, canonical problems are looked up after the uniqueness check, and their exact ratings are added.
+	//Ratings are not invariant under isomorphism, so other problems are always rated.
+	//Problems not checked (--nocheck) are neither looked up nor added, as the store has ratings of unique problems only.
+	long long raterAllocations = 0;
+	//for --profile. Problems taken from the store or without a unique solution are not rated, and have no profile.
+	struct ProfileEntry {
+		bool rated;
+		double seconds;
+		Rater::Profile profile;
+
+		ProfileEntry() : rated(false), seconds(0) {}
+	};
+	//check: check the uniqueness here. checked: the uniqueness has been checked (with --batchsolver).
+	auto rateProblem = [&store, useFastRater, useFastSolver, threshold, countAllocations, &raterAllocations](const char *problem, bool check, bool checked, Solver &solver, FastSolver &fastSolver, Rater &rater, FastRater &fastRater, const Canonicalizer &canonicalizer, ProfileEntry *profileEntry) -> long long {
+		if(check && (useFastSolver ? fastSolver.solve(problem) : solver.solve(problem)) != 1)
+			return -1;
+		bool useStore = store && (check || checked) && canonicalizer.canonicalizeProblem(problem) == problem;
+		long long rate;
+		if(useStore && store->find(problem, rate))
+			return rate;
+		long long allocations = AllocationCounter::get();
+		if(profileEntry != nullptr)
+			rater.resetProfile();
+		auto start = chrono::steady_clock::now();
+		rate = useFastRater ? fastRater.rateBounded(problem, threshold) : rater.rateBounded(problem, threshold);
+		if(profileEntry != nullptr) {
+			profileEntry->rated = true;
+			profileEntry->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			profileEntry->profile = rater.getProfile();
+		}
+		if(countAllocations)
+			raterAllocations += AllocationCounter::get() - allocations;
+		if(useStore && rate < threshold)
+			store->insert(problem, rate);
+		return rate;
+	};
+	ProfileEntry profileTotal;
+	int profiledProblems = 0;
+	auto printProfile = [](const string &problem, const ProfileEntry &entry) {
+		if(entry.rated)
+			fprintf(stderr, "profile: %s time: %.3fms, %s\n", problem.c_str(), entry.seconds * 1e3, entry.profile.toString().c_str());
+	};
+	auto addProfile = [&profileTotal, &profiledProblems](const ProfileEntry &entry) {
+		if(entry.rated) {
+			++ profiledProblems;
+			profileTotal.seconds += entry.seconds;
+			profileTotal.profile.add(entry.profile);
+		}
+	};
+	auto printProfileTotal = [profile, &profileTotal, &profiledProblems]() {
+		if(profile)
+			fprintf(stderr, "profile total: %d problems rated, time: %.3fs, %s\n", profiledProblems, profileTotal.seconds, profileTotal.profile.toString().c_str());
+	};
+	//with --batchsolver, the uniqueness of a batch of problems is checked before rating them (the counts are 0, 1 or 2)
+	BatchSolver batchSolver;
+	auto checkInBatch = [&batchSolver](const vector<string> &problems, vector<long long> &counts) {
+		vector<string> solutions;
+		batchSolver.solve(problems, 2, counts, solutions);
+	};
+	auto printStoreStats = [&store]() {
+		if(store)
+			cerr << "rating store: " << store->getServed() << " served, " << store->getAdded() << " added, " << store->size() << " ratings" << endl;
+	};
 	if(threads != 1) {
 		vector<string> problems;
 		{
@@ -105,6 +258,9 @@ int commandRate(const vector<string> &positional, const unordered_map<string, st
 			}
 		}
 		cerr << problems.size() << " problems" << endl;
+		vector<long long> counts;
+		if(useBatchSolver)
+			checkInBatch(problems, counts);
 		ThreadSafeQueue<int> workQ(problems.size() + threads);
 		rep(i, problems.size())
 			workQ.enqueue(i);
@@ -112,17 +268,28 @@ int commandRate(const vector<string> &positional, const unordered_map<string, st
 			workQ.enqueue(-1);
 		ThreadSafeQueue<bool> endQ(threads);
 		vector<long long> res(problems.size());
+		vector<ProfileEntry> profiles(profile ? problems.size() : 0);
 		int progress = 0;
 		mutex mx;
 		rep(i, threads) {
-			thread([memoSize, &problems, &res, &workQ, &endQ, &progress, &mx]() {
-				Rater rater(memoSize);
+			thread([memoSize, useFastRater, intraThreads, memoWays, undoTrail, profile, useBatchSolver, &shareMemo, &addMemoStats, &rateProblem, &problems, &counts, &res, &profiles, &workQ, &endQ, &progress, &mx]() {
+				Rater rater(useFastRater ? 0 : memoSize, intraThreads, memoWays);
+				FastRater fastRater(useFastRater ? memoSize : 0, memoWays);
+				shareMemo(rater, fastRater);
+				rater.setUndoTrail(undoTrail);
+				rater.setProfiling(profile);
 				Solver solver(0);
+				solver.setUndoTrail(undoTrail);
+				FastSolver fastSolver(0);
+				Canonicalizer canonicalizer;
 				while(1) {
 					int problemID = workQ.dequeue();
 					if(problemID == -1) break;
 					const char *problem = problems[problemID].c_str();
-					res[problemID] = solver.solve(problem) != 1 ? -1 : rater.rate(problem);
+					if(useBatchSolver && counts[problemID] != 1)
+						res[problemID] = -1;
+					else
+						res[problemID] = rateProblem(problem, !useBatchSolver, useBatchSolver, solver, fastSolver, rater, fastRater, canonicalizer, profile ? &profiles[problemID] : nullptr);
 					{
 						lock_guard<mutex> lock(mx);
 						++ progress;
@@ -130,39 +297,190 @@ int commandRate(const vector<string> &positional, const unordered_map<string, st
 							cerr << progress << " / " << problems.size() << " (" << progress * 1000LL / problems.size() / 10. << "%)...\r";
 					}
 				}
+				rater.flushMemoStats();
+				fastRater.flushMemoStats();
+				addMemoStats(rater, fastRater);
 				endQ.enqueue(true);
 			}).detach();
 		}
 		rep(i, threads)
 			endQ.dequeue();
+		printMemoStats();
+		printStoreStats();
+		//the profiles are printed in the order of the problems, and then summed up
+		rep(i, profiles.size()) {
+			printProfile(problems[i], profiles[i]);
+			addProfile(profiles[i]);
+		}
+		printProfileTotal();
 		rep(i, problems.size()) {
 			long long rate = res[i];
-			cout << problems[i] << " " << rate << " " << Rater::squash(rate) << endl;
+			//ratings at or above the threshold are lower bounds
+			const char *bound = rate >= threshold ? "+" : "";
+			cout << problems[i] << " " << rate << bound << " " << Rater::squash(rate) << bound << endl;
 		}
 		return 0;
 	} else {
 		string problem;
-		Rater rater(memoSize);
+		Rater rater(useFastRater ? 0 : memoSize, intraThreads, memoWays);
+		FastRater fastRater(useFastRater ? memoSize : 0, memoWays);
+		shareMemo(rater, fastRater);
+		rater.setUndoTrail(undoTrail);
+		rater.setProfiling(profile);
 		Solver solver(0);
-		while(cin >> problem) {
+		solver.setUndoTrail(undoTrail);
+		FastSolver fastSolver(0);
+		Canonicalizer canonicalizer;
+		//allocations while rating the first problem (the buffers of the raters grow) and the rest
+		long long firstAllocations = -1;
+		//without --batchsolver, a batch is one problem
+		const size_t BatchSize = useBatchSolver && !nocheck ? 4096 : 1;
+		vector<string> batch;
+		vector<long long> counts;
+		bool end = false;
+		while(!end) {
+			batch.clear();
+			while(batch.size() < BatchSize && !(end = !(cin >> problem))) {
+				checkProblem(problem);
+				batch.push_back(problem);
+			}
+			if(BatchSize != 1)
+				checkInBatch(batch, counts);
+			rep(i, batch.size()) {
+				ProfileEntry profileEntry;
+				long long rate;
+				if(BatchSize != 1 && counts[i] != 1)
+					rate = -1;
+				else
+					rate = rateProblem(batch[i].c_str(), !nocheck && BatchSize == 1, BatchSize != 1, solver, fastSolver, rater, fastRater, canonicalizer, profile ? &profileEntry : nullptr);
+				const char *bound = rate >= threshold ? "+" : "";
+				cout << batch[i] << " " << rate << bound << " " << Rater::squash(rate) << bound << endl;
+				printProfile(batch[i], profileEntry);
+				addProfile(profileEntry);
+				if(firstAllocations == -1)
+					firstAllocations = raterAllocations;
+			}
+		}
+		if(countAllocations)
+			cerr << "rater allocations: " << max(firstAllocations, 0LL) << " in the first problem, " << raterAllocations - max(firstAllocations, 0LL) << " in the rest (this thread only)" << endl;
+		rater.flushMemoStats();
+		fastRater.flushMemoStats();
+		addMemoStats(rater, fastRater);
+		printMemoStats();
+		printStoreStats();
+		printProfileTotal();
+	}
+	return 0;
+}
+
+//Rates problems and their neighbours (a clue removed, or a clue of the solution added) with one Rater,
+//whose memo holds the states of the problem when its neighbours are rated.
+int commandNeighbours(const vector<string> &positional, const unordered_map<string, string> &arguments) {
+	checkArgument(positional.size() == 1);
+	size_t memoSize = 10000;
+	long long threshold = numeric_limits<long long>::max();
+	for(const auto &p : arguments) {
+		if(p.first == "memosize") {
+			memoSize = parseInt(p.second, 0, 10000000);
+		} else if(p.first == "threshold") {
+			threshold = parseInt(p.second, 0, numeric_limits<int>::max());
+		} else {
+			checkArgument(false);
+		}
+	}
+	Rater rater(memoSize);
+	Solver solver(0);
+	auto print = [threshold](const string &problem, long long rate) {
+		const char *bound = rate >= threshold ? "+" : "";
+		cout << problem << " " << rate << bound << " " << Rater::squash(rate) << bound << endl;
+	};
+	string problem;
+	while(cin >> problem) {
+		checkProblem(problem);
+		char solution[82];
+		if(solver.solve(problem.c_str()) != 1 || !solver.findSolution(problem.c_str(), solution)) {
+			print(problem, -1);
+			continue;
+		}
+		vector<string> problems(1, problem);
+		rep(cell, 81) {
+			string neighbour = problem;
+			neighbour[cell] = problem[cell] == '0' ? solution[cell] : '0';
+			problems.push_back(neighbour);
+		}
+		//removing a clue may make the solution not unique
+		vector<bool> unique(problems.size());
+		rep(i, problems.size())
+			unique[i] = i == 0 || problem[i - 1] == '0' || solver.solve(problems[i].c_str()) == 1;
+		rep(i, problems.size())
+			print(problems[i], unique[i] ? rater.rateBounded(problems[i].c_str(), threshold) : -1);
+	}
+	return 0;
+}
+
+//solve --batchsolver: the problems are read in batches. --benchmark compares with FastSolver.
+static int solveInBatches(int memoSize, long long limit, bool benchmark) {
+	const size_t BatchSize = 4096;
+	BatchSolver batchSolver;
+	FastSolver fastSolver(memoSize);
+	vector<string> problems;
+	vector<long long> counts;
+	vector<string> solutions;
+	double times[2] = {}, user, sys;
+	long long numProblems = 0, mismatches = 0;
+	string problem;
+	bool end = false;
+	while(!end) {
+		problems.clear();
+		while(problems.size() < BatchSize && !(end = !(cin >> problem))) {
 			checkProblem(problem);
-			bool ok = true;
-			if(!nocheck) {
-				int num = solver.solve(problem.c_str());
-				ok = num == 1;
+			problems.push_back(problem);
+		}
+		getCPUTime(user, sys);
+		times[1] -= user;
+		batchSolver.solve(problems, limit, counts, solutions);
+		getCPUTime(user, sys);
+		times[1] += user;
+		rep(i, problems.size()) {
+			if(benchmark) {
+				char solution[82];
+				times[0] -= user;
+				long long num = fastSolver.countSolutions(problems[i].c_str(), limit);
+				if(num == 1)
+					fastSolver.findSolution(problems[i].c_str(), solution);
+				getCPUTime(user, sys);
+				times[0] += user;
+				if(num != counts[i] || (num == 1 && solutions[i] != string(solution, 81))) {
+					cerr << "mismatch: " << problems[i] << " " << counts[i] << " " << num << endl;
+					++ mismatches;
+				}
 			}
-			long long rate = !ok ? -1 : rater.rate(problem.c_str());
-			cout << problem << " " << rate << " " << Rater::squash(rate) << endl;
+			cout << solutions[i] << " " << counts[i] << endl;
 		}
+		numProblems += problems.size();
+	}
+	if(benchmark) {
+		fprintf(stderr, "%lld problems, %lld mismatches\n", numProblems, mismatches);
+		fprintf(stderr, "FastSolver: %.3fs, BatchSolver: %.3fs\n", times[0], times[1]);
 	}
 	return 0;
 }
 
+//--benchmark also solves the problems with the other solvers, and compares the times and the results.
 int commandSolve(const vector<string> &positional, const unordered_map<string, string> &arguments) {
 	checkArgument(positional.size() == 1);
 	int memoSize = 100000;
 	bool nocheck = false;
 	bool randomize = false;
+	bool undoTrail = false;
+	bool useFastSolver = false;
+	bool useBatchSolver = false;
+	bool useDLX = false;
+	long long limit = -1;
+	bool benchmark = false;
+	bool count = false;
+	bool all = false;
+	int threads = 1;
 	for(const auto &p : arguments) {
 		if(p.first == "memosize") {
 			memoSize = parseInt(p.second, 0, 10000000);
@@ -172,44 +490,176 @@ int commandSolve(const vector<string> &positional, const unordered_map<string, s
 		} else if(p.first == "randomize") {
 			checkArgument(p.second.empty());
 			randomize = true;
+		} else if(p.first == "undotrail") {
+			checkArgument(p.second.empty());
+			undoTrail = true;
+		} else if(p.first == "fastsolver") {
+			checkArgument(p.second.empty());
+			useFastSolver = true;
+		} else if(p.first == "batchsolver") {
+			checkArgument(p.second.empty());
+			useBatchSolver = true;
+		} else if(p.first == "dlx") {
+			checkArgument(p.second.empty());
+			useDLX = true;
+		} else if(p.first == "limit") {
+			limit = parseInt(p.second, 1, numeric_limits<int>::max());
+		} else if(p.first == "benchmark") {
+			checkArgument(p.second.empty());
+			benchmark = true;
+		} else if(p.first == "count") {
+			checkArgument(p.second.empty());
+			count = true;
+		} else if(p.first == "all") {
+			checkArgument(p.second.empty());
+			all = true;
+		} else if(p.first == "threads") {
+			threads = parseInt(p.second, 1, 1024);
 		} else {
 			checkArgument(false);
 		}
 	}
+	if(count || all) {
+		checkArgument(!(count && all), "--count and --all cannot be used together");
+		checkArgument(!nocheck && !randomize && !benchmark && !undoTrail && !useBatchSolver, "--count and --all do not take --nocheck, --randomize, --benchmark, --undotrail or --batchsolver");
+		checkArgument(!useDLX || threads == 1, "--threads is not supported with --dlx");
+		//the counts are followed by '+' if they reach the limit
+		SolutionEnumerator enumerator(threads, useDLX ? 0 : memoSize);
+		DLXSolver dlxSolver;
+		if(limit == -1)
+			limit = numeric_limits<long long>::max();
+		auto printSolution = [](const string &solution) { cout << solution << '\n'; };
+		string problem;
+		while(cin >> problem) {
+			checkProblem(problem);
+			long long num;
+			if(count) {
+				num = useDLX ? dlxSolver.countSolutions(problem.c_str(), limit) : enumerator.countSolutions(problem.c_str(), limit);
+				cout << problem << " " << num << (num >= limit ? "+" : "") << endl;
+			} else {
+				if(useDLX)
+					num = dlxSolver.enumerateSolutions(problem.c_str(), limit, printSolution);
+				else
+					num = enumerator.enumerateSolutions(problem.c_str(), limit, printSolution);
+				cout << flush;
+				cerr << problem << ": " << num << (num >= limit ? "+" : "") << " solutions" << endl;
+			}
+		}
+		return 0;
+	}
+	checkArgument(threads == 1, "--threads needs --count or --all");
+	if(limit == -1)
+		limit = 2;
+	if(useBatchSolver) {
+		checkArgument(!useFastSolver && !useDLX && !nocheck && !randomize && !undoTrail, "--batchsolver does not take --fastsolver, --dlx, --nocheck, --randomize or --undotrail");
+		return solveInBatches(memoSize, limit, benchmark);
+	}
+	checkArgument(!useFastSolver || !useDLX, "--fastsolver and --dlx cannot be used together");
+	checkArgument(useFastSolver || useDLX || limit == 2, "--limit needs --fastsolver or --dlx");
+	checkArgument(!(useFastSolver || useDLX) || !undoTrail, "--undotrail is not supported with --fastsolver or --dlx");
 	Solver solver(memoSize);
-	if(randomize)
+	FastSolver fastSolver(memoSize);
+	DLXSolver dlxSolver;
+	solver.setUndoTrail(undoTrail);
+	if(randomize) {
 		solver.setRandomEngine(default_random_engine{ random_device{}() });
-	string problem;
-	while(cin >> problem) {
-		char solution[82];
-		checkProblem(problem);
-		int num = nocheck ? 1 : solver.solve(problem.c_str());
+		fastSolver.setRandomEngine(default_random_engine{ random_device{}() });
+		dlxSolver.setRandomEngine(default_random_engine{ random_device{}() });
+	}
+	//the solvers by index
+	enum { UseSolver, UseFastSolver, UseDLX, NumSolvers };
+	const char *solverNames[NumSolvers] = { "Solver", "FastSolver", "DLXSolver" };
+	int used = useDLX ? UseDLX : useFastSolver ? UseFastSolver : UseSolver;
+	//the number of solutions (up to limit, or 2 with Solver)
+	auto solveProblem = [nocheck, randomize, limit, &solver, &fastSolver, &dlxSolver](int which, const string &problem, char *solution) -> long long {
+		long long num;
+		if(nocheck)
+			num = 1;
+		else if(which == UseSolver)
+			num = solver.solve(problem.c_str());
+		else if(which == UseFastSolver)
+			num = fastSolver.countSolutions(problem.c_str(), limit);
+		else
+			num = dlxSolver.countSolutions(problem.c_str(), limit);
 		if(num > 0) {
-			if(!solver.findSolution(problem.c_str(), solution, randomize))
+			bool found;
+			if(which == UseSolver)
+				found = solver.findSolution(problem.c_str(), solution, randomize);
+			else if(which == UseFastSolver)
+				found = fastSolver.findSolution(problem.c_str(), solution, randomize);
+			else
+				found = dlxSolver.findSolution(problem.c_str(), solution, randomize);
+			if(!found)
 				num = 0;
 		}
 		if(num == 0)
 			fill(solution, solution + 81, '0');
 		solution[81] = 0;
+		return num;
+	};
+	double times[NumSolvers] = {}, user, sys;
+	long long problems = 0, mismatches = 0;
+	string problem;
+	while(cin >> problem) {
+		char solution[82];
+		checkProblem(problem);
+		getCPUTime(user, sys);
+		times[used] -= user;
+		long long num = solveProblem(used, problem, solution);
+		getCPUTime(user, sys);
+		times[used] += user;
+		if(benchmark) {
+			rep(other, NumSolvers) {
+				if(other == used)
+					continue;
+				char otherSolution[82];
+				times[other] -= user;
+				long long otherNum = solveProblem(other, problem, otherSolution);
+				getCPUTime(user, sys);
+				times[other] += user;
+				//the solutions are compared only for unique ones, and the counts up to 2
+				if(min(num, 2LL) != min(otherNum, 2LL) || (num == 1 && strcmp(solution, otherSolution) != 0)) {
+					cerr << "mismatch (" << solverNames[other] << "): " << problem << " " << num << " " << otherNum << endl;
+					++ mismatches;
+				}
+			}
+			//the counts of FastSolver stay within the limit of each call, after the counts with the other limits on its memo
+			if(!nocheck && (num > limit || fastSolver.solve(problem.c_str()) != min(num, 2LL)
+				|| fastSolver.countSolutions(problem.c_str(), limit) != num)) {
+				cerr << "mismatch (FastSolver with limits " << limit << " and 2): " << problem << " " << num << endl;
+				++ mismatches;
+			}
+			++ problems;
+		}
 		if(nocheck)
 			cout << solution << endl;
 		else
 			cout << solution << " " << num << endl;
 	}
+	if(benchmark) {
+		fprintf(stderr, "%lld problems, %lld mismatches\n", problems, mismatches);
+		rep(i, NumSolvers)
+			fprintf(stderr, "%s: %.3fs%s", solverNames[i], times[i], i + 1 < NumSolvers ? ", " : "\n");
+	}
 	return 0;
 }
 
 int commandFindUASets(const vector<string> &positional, const unordered_map<string, string> &arguments) {
 	checkArgument(positional.size() == 1);
 	int sizeLimit = 12;
+	bool undoTrail = false;
 	for(const auto &p : arguments) {
 		if(p.first == "size") {
 			sizeLimit = parseInt(p.second, 1, 81);
+		} else if(p.first == "undotrail") {
+			checkArgument(p.second.empty());
+			undoTrail = true;
 		} else {
 			checkArgument(false);
 		}
 	}
 	UAFinder finder;
+	finder.setUndoTrail(undoTrail);
 	string solution;
 	while(cin >> solution) {
 		checkSolution(solution);
@@ -220,6 +670,83 @@ int commandFindUASets(const vector<string> &positional, const unordered_map<stri
 	return 0;
 }
 
+//Times UniquenessChecker::isSolutionUnique against InterleavedChecker on random clue masks of the solutions,
+//with a fresh memo of each size for each solution.
+int commandCheckBench(const vector<string> &positional, const unordered_map<string, string> &arguments) {
+	checkArgument(positional.size() == 1);
+	int numClues = 26, numMasks = 1000, interleave = 8;
+	vector<int> memoSizes{ 1 << 16, 1 << 20, 1 << 22 };
+	for(const auto &p : arguments) {
+		if(p.first == "clues") {
+			numClues = parseInt(p.second, 17, 81);
+		} else if(p.first == "masks") {
+			numMasks = parseInt(p.second, 1, 10000000);
+		} else if(p.first == "interleave") {
+			interleave = parseInt(p.second, 1, 256);
+		} else if(p.first == "memosizes") {
+			memoSizes.clear();
+			stringstream ss(p.second);
+			string size;
+			while(getline(ss, size, ','))
+				memoSizes.push_back(parseInt(size, 1, 100000000));
+			checkArgument(!memoSizes.empty());
+		} else {
+			checkArgument(false);
+		}
+	}
+	vector<string> solutions;
+	string solution;
+	while(cin >> solution) {
+		checkSolution(solution);
+		solutions.push_back(solution);
+	}
+	mt19937 engine(1);
+	vector<vector<Mask128> > masks(solutions.size());
+	for(auto &v : masks) {
+		rep(i, numMasks) {
+			int cells[81];
+			iota(cells, cells + 81, 0);
+			shuffle(cells, cells + 81, engine);
+			Mask128 mask(0);
+			rep(k, numClues)
+				mask.set(cells[k]);
+			v.push_back(mask);
+		}
+	}
+
+	UniquenessChecker checker;
+	InterleavedChecker interleavedChecker;
+	vector<bool> expected(numMasks);
+	unique_ptr<bool[]> results(new bool[numMasks]);
+	for(int memoSize : memoSizes) {
+		double times[2] = {}, user, sys;
+		long long uniques = 0, mismatches = 0;
+		rep(s, solutions.size()) {
+			checker.setSolution(solutions[s].c_str(), memoSize);
+			getCPUTime(user, sys);
+			times[0] -= user;
+			rep(i, numMasks)
+				expected[i] = checker.isSolutionUnique(masks[s][i]);
+			getCPUTime(user, sys);
+			times[0] += user;
+			interleavedChecker.setSolution(solutions[s].c_str(), memoSize);
+			getCPUTime(user, sys);
+			times[1] -= user;
+			for(int i = 0; i < numMasks; i += interleave)
+				interleavedChecker.areSolutionsUnique(&masks[s][i], min(interleave, numMasks - i), &results[i]);
+			getCPUTime(user, sys);
+			times[1] += user;
+			rep(i, numMasks) {
+				uniques += expected[i];
+				mismatches += expected[i] != results[i];
+			}
+		}
+		fprintf(stderr, "memosize %d: %lld unique, %lld mismatches, sequential %.3fs, interleaved (%d) %.3fs\n",
+			memoSize, uniques, mismatches, times[0], interleave, times[1]);
+	}
+	return 0;
+}
+
 int commandPrintSymmetries(const vector<string> &positional, const unordered_map<string, string> &arguments) {
 	checkArgument(positional.size() == 1);
 	for(const auto &p : arguments) {
@@ -840,7 +1367,10 @@ int commandFullsearch(const vector<string> &positional, const unordered_map<stri
 	checkArgument(positional.size() == 1);
 	size_t memoSize = 1 << 16;
 	int rateThreshold = 10000;
+	bool boundedRating = false;
+	bool sharedMemo = false;
 	int workers = -1;
+	string storeFilename;
 
 	for(const auto &p : arguments) {
 		if(p.first == "masks") {
@@ -853,8 +1383,17 @@ int commandFullsearch(const vector<string> &positional, const unordered_map<stri
 			memoSize = parseInt(p.second, 0, numeric_limits<int>::max());
 		} else if(p.first == "threshold") {
 			rateThreshold = parseInt(p.second, 0, numeric_limits<int>::max());
+		} else if(p.first == "bounded") {
+			checkArgument(p.second.empty());
+			boundedRating = true;
+		} else if(p.first == "sharedmemo") {
+			checkArgument(p.second.empty());
+			sharedMemo = true;
 		} else if(p.first == "workers") {
 			workers = parseInt(p.second, 1, 1024);
+		} else if(p.first == "store") {
+			checkArgument(!p.second.empty());
+			storeFilename = p.second;
 		} else {
 			checkArgument(false);
 		}
@@ -864,12 +1403,27 @@ int commandFullsearch(const vector<string> &positional, const unordered_map<stri
 	if(workers == -1)
 		workers = (int)thread::hardware_concurrency();
 
+	//with --sharedmemo, the workers use tables as large as all their private tables
+	Rater::SharedMemo raterMemo;
+	UniquenessChecker::SharedMemo checkerMemo;
+	if(sharedMemo) {
+		raterMemo.init((size_t)10000 * workers);	//FullSearcher's Rater has the default memo size
+		checkerMemo.init(memoSize * workers);
+	}
+
+	unique_ptr<RatingStore> store;
+	if(!storeFilename.empty())
+		store.reset(new RatingStore(storeFilename));
+
 	ThreadSafeQueue<Mask81> maskQueue(workers + 1);
 	vector<thread> threads(workers);
 
 	rep(threadi, workers) {
 		threads[threadi] = thread([&] {
-			FullSearcher searcher(memoSize, rateThreshold, outputLogger, infoLogger);
+			FullSearcher searcher(memoSize, rateThreshold, boundedRating, outputLogger, infoLogger);
+			if(sharedMemo)
+				searcher.shareMemo(&raterMemo, &checkerMemo);
+			searcher.setRatingStore(store.get());
 			while(1) {
 				Mask81 mask = maskQueue.dequeue();
 				if(mask.count() == 0)
@@ -901,6 +1455,23 @@ int commandFullsearch(const vector<string> &positional, const unordered_map<stri
 	rep(i, workers)
 		threads[i].join();
 
+	if(sharedMemo) {
+		infoLogger.log("shared rater memo: ", raterMemo.getStats().toString());
+		infoLogger.log("shared checker memo: ", checkerMemo.getStats().toString());
+	}
+	if(store)
+		infoLogger.log("rating store: ", store->getServed(), " served, ", store->getAdded(), " added, ", store->size(), " ratings");
+	return 0;
+}
+
+int commandCompactStore(const vector<string> &positional, const unordered_map<string, string> &arguments) {
+	checkArgument(positional.size() == 2 && arguments.empty());
+	long long duplicates, invalid;
+	if(!RatingStore::compact(positional[1], duplicates, invalid)) {
+		cerr << positional[1] << " is in use by rate, combine or fullsearch; not compacted" << endl;
+		return 1;
+	}
+	cerr << duplicates << " duplicated lines removed, " << invalid << " invalid lines removed" << endl;
 	return 0;
 }
 
@@ -930,10 +1501,14 @@ int commandsMain(const vector<string> &args) {
 	checkArgument(!positional.empty());
 	if(positional[0] == "rate") {
 		return commandRate(positional, arguments);
+	} else if(positional[0] == "neighbours") {
+		return commandNeighbours(positional, arguments);
 	} else if(positional[0] == "solve") {
 		return commandSolve(positional, arguments);
 	} else if(positional[0] == "finduasets") {
 		return commandFindUASets(positional, arguments);
+	} else if(positional[0] == "checkbench") {
+		return commandCheckBench(positional, arguments);
 	} else if(positional[0] == "printsymmetries") {
 		return commandPrintSymmetries(positional, arguments);
 	} else if(positional[0] == "canonicalize") {
@@ -956,6 +1531,8 @@ int commandsMain(const vector<string> &args) {
 		return commandStronglyUnique(positional, arguments);
 	} else if(positional[0] == "fullsearch") {
 		return commandFullsearch(positional, arguments);
+	} else if(positional[0] == "compactstore") {
+		return commandCompactStore(positional, arguments);
 	} else {
 		checkArgument(false, "error: no command");
 	}
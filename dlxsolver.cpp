@@ -0,0 +1,192 @@
+#include "dlxsolver.hpp"
+#include "util.hpp"
+#include <algorithm>
+
+using namespace std;
+
+DLXSolver::DLXSolver() : _randomize(false), _found(false) {
+	_nodes.resize(Columns + 1 + 729 * 4);
+	rep(c, Columns + 1) {
+		Node &header = _nodes[c];
+		header.left = c == 0 ? Columns : c - 1;
+		header.right = c == Columns ? 0 : c + 1;
+		header.up = header.down = c;
+		header.column = c;
+		header.row = -1;
+		_sizes[c] = 0;
+		_covered[c] = false;
+	}
+	int next = Columns + 1;
+	rep(cell, 81) rep(digit, 9) {
+		int row = cell / 9, col = cell % 9, box = row / 3 * 3 + col / 3;
+		const int columns[4] = { cell, 81 + row * 9 + digit, 162 + col * 9 + digit, 243 + box * 9 + digit };
+		int first = next;
+		_rowNodes[cell * 9 + digit] = first;
+		rep(k, 4) {
+			int c = columns[k] + 1;
+			Node &node = _nodes[next];
+			node.left = k == 0 ? first + 3 : next - 1;
+			node.right = k == 3 ? first : next + 1;
+			node.up = _nodes[c].up;
+			node.down = c;
+			node.column = c;
+			node.row = cell * 9 + digit;
+			_nodes[_nodes[c].up].down = next;
+			_nodes[c].up = next;
+			++ _sizes[c];
+			++ next;
+		}
+	}
+}
+
+void DLXSolver::cover(int column) {
+	Node &header = _nodes[column];
+	_nodes[header.right].left = header.left;
+	_nodes[header.left].right = header.right;
+	_covered[column] = true;
+	for(int i = header.down; i != column; i = _nodes[i].down) {
+		for(int j = _nodes[i].right; j != i; j = _nodes[j].right) {
+			const Node &node = _nodes[j];
+			_nodes[node.down].up = node.up;
+			_nodes[node.up].down = node.down;
+			-- _sizes[node.column];
+		}
+	}
+}
+
+void DLXSolver::uncover(int column) {
+	Node &header = _nodes[column];
+	for(int i = header.up; i != column; i = _nodes[i].up) {
+		for(int j = _nodes[i].left; j != i; j = _nodes[j].left) {
+			const Node &node = _nodes[j];
+			++ _sizes[node.column];
+			_nodes[node.down].up = j;
+			_nodes[node.up].down = j;
+		}
+	}
+	_covered[column] = false;
+	_nodes[header.right].left = column;
+	_nodes[header.left].right = column;
+}
+
+bool DLXSolver::load(const char *problem) {
+	_selected.clear();
+	rep(cell, 81) {
+		int c = problem[cell];
+		if(c < '1' || '9' < c)
+			continue;
+		int first = _rowNodes[cell * 9 + (c - '1')];
+		int j = first;
+		do {
+			if(_covered[_nodes[j].column])
+				return false;
+			j = _nodes[j].right;
+		} while(j != first);
+		do {
+			cover(_nodes[j].column);
+			j = _nodes[j].right;
+		} while(j != first);
+		_selected.push_back(first);
+	}
+	return true;
+}
+
+void DLXSolver::unload() {
+	while(!_selected.empty()) {
+		int first = _selected.back();
+		_selected.pop_back();
+		int j = first;
+		do {
+			j = _nodes[j].left;
+			uncover(_nodes[j].column);
+		} while(j != first);
+	}
+}
+
+void DLXSolver::storeSolution(char *solution) const {
+	fill(solution, solution + 81, '0');
+	for(int first : _selected) {
+		int row = _nodes[first].row;
+		solution[row / 9] = (char)('1' + row % 9);
+	}
+}
+
+long long DLXSolver::search(long long limit, const function<void(const string &)> *output) {
+	if(_nodes[Root].right == Root) {
+		if(!_found) {
+			storeSolution(_solution);
+			_found = true;
+		}
+		if(output != nullptr) {
+			char solution[81];
+			storeSolution(solution);
+			(*output)(string(solution, 81));
+		}
+		return 1;
+	}
+
+	//the column with the fewest rows
+	int column = -1, minSize = 10;
+	for(int c = _nodes[Root].right; c != Root; c = _nodes[c].right) {
+		if(minSize > _sizes[c]) {
+			minSize = _sizes[c];
+			column = c;
+			if(minSize <= 1)
+				break;
+		}
+	}
+	if(minSize == 0)
+		return 0;
+
+	int rows[9], numRows = 0;
+	for(int i = _nodes[column].down; i != column; i = _nodes[i].down)
+		rows[numRows ++] = i;
+	if(_randomize)
+		shuffle(rows, rows + numRows, _randomEngine);
+
+	cover(column);
+	long long total = 0;
+	rep(k, numRows) {
+		int i = rows[k];
+		for(int j = _nodes[i].right; j != i; j = _nodes[j].right)
+			cover(_nodes[j].column);
+		_selected.push_back(i);
+		total += search(limit - total, output);
+		_selected.pop_back();
+		for(int j = _nodes[i].left; j != i; j = _nodes[j].left)
+			uncover(_nodes[j].column);
+		if(total >= limit)
+			break;
+	}
+	uncover(column);
+	return total;
+}
+
+long long DLXSolver::countSolutions(const char *problem, long long limit) {
+	_randomize = false;
+	_found = false;
+	long long count = load(problem) ? search(limit, nullptr) : 0;
+	unload();
+	return count;
+}
+
+bool DLXSolver::findSolution(const char *problem, char *solution, bool randomize) {
+	_randomize = randomize;
+	_found = false;
+	if(load(problem))
+		search(1, nullptr);
+	unload();
+	if(_found)
+		copy(_solution, _solution + 81, solution);
+	else
+		fill(solution, solution + 81, '0');
+	return _found;
+}
+
+long long DLXSolver::enumerateSolutions(const char *problem, long long limit, const function<void(const string &)> &output) {
+	_randomize = false;
+	_found = false;
+	long long count = load(problem) ? search(limit, &output) : 0;
+	unload();
+	return count;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <random>
+#include <vector>
+#include <string>
+#include <functional>
+
+//Solver by dancing links (Knuth's Algorithm X), with the interface of FastSolver.
+//A problem is an exact cover of 324 columns (a digit in each cell, and each digit in each row, column and box)
+//by the 729 rows (a digit in a cell). The matrix is built once, and the clues and the guesses are undone after each problem.
+class DLXSolver {
+public:
+	DLXSolver();
+
+	//same as Solver::solve: 0, 1, or 2 for two or more solutions
+	int solve(const char *problem) { return (int)countSolutions(problem, 2); }
+	//the number of solutions, or limit if there are limit or more (limit >= 1)
+	long long countSolutions(const char *problem, long long limit);
+	bool findSolution(const char *problem, char *solution, bool randomize = false);
+	//calls output for the first limit solutions (or all of them if fewer) as they are found, and returns the number of them
+	long long enumerateSolutions(const char *problem, long long limit, const std::function<void(const std::string &)> &output);
+
+	void setRandomEngine(std::default_random_engine re) { _randomEngine = re; }
+	const std::default_random_engine &getRandomEngine() const { return _randomEngine; }
+
+private:
+	enum { Columns = 324, Root = 0 };
+
+	//headers are nodes 1 to Columns (column c + 1), with Root before them; row is the (cell * 9 + digit) of a node
+	struct Node {
+		int left, right, up, down;
+		int column, row;
+	};
+
+	//covers the columns of the clues; false if clues contradict each other
+	bool load(const char *problem);
+	//uncovers the columns of the clues
+	void unload();
+	void cover(int column);
+	void uncover(int column);
+	//output is called for the solutions if it is not null, and the first one is stored to _solution
+	long long search(long long limit, const std::function<void(const std::string &)> *output);
+	void storeSolution(char *solution) const;
+
+	std::vector<Node> _nodes;
+	int _sizes[Columns + 1];
+	bool _covered[Columns + 1];
+	//the first node of each row
+	int _rowNodes[729];
+	//rows of the clues and then of the guesses
+	std::vector<int> _selected;
+	bool _randomize;
+	bool _found;
+	char _solution[81];
+	std::default_random_engine _randomEngine;
+};
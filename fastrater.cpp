@@ -1,6 +1,176 @@
 #include "fastrater.hpp"
+#include "util.hpp"
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <limits>
+
+using namespace std;
+
+static bool hasMultipleBits(Mask128 m) {
+	return m.countOneBits() > 1;
+}
+
+template<typename Func>
+static void forEachCell(Mask128 m, Func func) {
+	rep(k, 2) for(int i : EachBit64(m.data[k]))
+		func(k * Mask128::HalfSize + i);
+}
+
+void FastRater::RaterGrid::init() {
+	initData();
+	FastGrid::initMasks();
+	_cells.init();
+	rep(d, 9)
+		_allowedMasks[d] = FastGrid::mask81;
+	std::fill(_units, _units + 27, FullMask());
+	_hash = getInitHashCellsAndUnits();
+}
+
+void FastRater::RaterGrid::load(const char *problem) {
+	init();
+	rep(cell, 81) {
+		if(auto h = parseHint(problem[cell]))
+			assignInstantly(cell, h.get());
+	}
+}
+
+FastRater::RaterGrid::Mask FastRater::RaterGrid::getCellMask(int cell) const {
+	Mask mask = 0;
+	rep(d, 9) if(_cells.digitMasks[d].get(cell))
+		mask |= 1 << d;
+	return mask;
+}
+
+//same as GsfGrid::setMask
+void FastRater::RaterGrid::assignInstantly(int cell, int digit) {
+	Mask changed = getCellMask(cell) ^ (1 << digit);
+	Mask128 cellBit(0);
+	cellBit.set(cell);
+	for(int d : EachBit(changed)) {
+		_cells.digitMasks[d] ^= cellBit;
+		_hash ^= getCellHashCoeff(cell, d);
+	}
+	toggleUnits(cell, digit);
+}
+
+void FastRater::RaterGrid::assign(int cell, int digit) {
+	applyMask(cell, 1 << digit);
+}
+
+void FastRater::RaterGrid::eliminate(int cell, int digit) {
+	applyMask(cell, (Mask)~(1 << digit));
+}
+
+//same as a move in GsfGrid::commit
+void FastRater::RaterGrid::applyMask(int cell, Mask mask) {
+	Mask cellMask = getCellMask(cell);
+	if(isSingleBitOrZero(cellMask))
+		return;
+	Mask changed = cellMask & ~mask;
+	for(int d : EachBit(changed)) {
+		_cells.digitMasks[d].unset(cell);
+		_hash ^= getCellHashCoeff(cell, d);
+	}
+	Mask t = cellMask & mask;
+	if(t != 0 && isSingleBitOrZero(t))
+		toggleUnits(cell, findFirstBitPos(t));
+}
+
+//assigned[d] must be a subset of the undetermined cells having d, and disjoint from each other
+void FastRater::RaterGrid::assignAll(const Mask128 *assigned) {
+	Mask128 all(0);
+	rep(d, 9)
+		all |= assigned[d];
+	rep(d, 9) {
+		Mask128 removed = _cells.digitMasks[d] & all & ~assigned[d];
+		forEachCell(removed, [this, d](int cell) {
+			_hash ^= getCellHashCoeff(cell, d);
+		});
+		_cells.digitMasks[d] ^= removed;
+	}
+	rep(d, 9) {
+		forEachCell(assigned[d], [this, d](int cell) {
+			toggleUnits(cell, d);
+		});
+	}
+}
+
+//eliminated[d] must not remove all the digits of a cell (see constraint_B)
+void FastRater::RaterGrid::eliminateAll(const Mask128 *eliminated) {
+	Mask128 touched(0);
+	rep(d, 9) {
+		Mask128 removed = _cells.digitMasks[d] & eliminated[d];
+		forEachCell(removed, [this, d](int cell) {
+			_hash ^= getCellHashCoeff(cell, d);
+		});
+		_cells.digitMasks[d] ^= removed;
+		touched |= removed;
+	}
+	if(!touched)
+		return;
+	Mask128 one(0), two(0);
+	rep(d, 9) {
+		two |= one & _cells.digitMasks[d];
+		one |= _cells.digitMasks[d];
+	}
+	Mask128 determined = touched & one & ~two;
+	rep(d, 9) {
+		forEachCell(determined & _cells.digitMasks[d], [this, d](int cell) {
+			toggleUnits(cell, d);
+		});
+	}
+}
+
+//same as GsfGrid::propagateMask (xor, so a digit can come back to a unit)
+void FastRater::RaterGrid::toggleUnits(int cell, int digit) {
+	bool restored = false;
+	rep(type, 3) {
+		int unit = cellUnit(cell, type);
+		_units[unit] ^= 1 << digit;
+		_hash ^= getUnitHashCoeff(unit, digit);
+		if(_units[unit] >> digit & 1)
+			restored = true;
+		else
+			_allowedMasks[digit] &= ~FastGrid::unitMasks[unit];
+	}
+	if(restored)
+		updateAllowedMask(digit);
+}
+
+void FastRater::RaterGrid::updateAllowedMask(int digit) {
+	Mask128 typeMasks[3] = { Mask128(0), Mask128(0), Mask128(0) };
+	rep(unit, 27) if(_units[unit] >> digit & 1)
+		typeMasks[unit / 9] |= FastGrid::unitMasks[unit];
+	_allowedMasks[digit] = typeMasks[0] & typeMasks[1] & typeMasks[2];
+}
+
+//cells which have two or more digits (not determined)
+Mask128 FastRater::RaterGrid::getUndeterminedMask() const {
+	Mask128 one(0), two(0);
+	rep(d, 9) {
+		two |= one & _cells.digitMasks[d];
+		one |= _cells.digitMasks[d];
+	}
+	return two;
+}
+
+//possible[d] has the cells where GsfGrid::isPossible(cell, d) holds
+void FastRater::RaterGrid::getPossibleMasks(Mask128 undetermined, Mask128 *possible) const {
+	rep(d, 9)
+		possible[d] = _cells.digitMasks[d] & (_allowedMasks[d] | ~undetermined);
+}
+
+//candidates[d] corresponds to GsfGrid::getUnitMask(unit, d) of all units
+void FastRater::RaterGrid::getUnitCandidateMasks(Mask128 undetermined, Mask128 *candidates) const {
+	rep(d, 9)
+		candidates[d] = _cells.digitMasks[d] & _allowedMasks[d] & undetermined;
+}
+
+FastRater::FastRater(size_t resultMemoSize, int memoWays) {
+	FastGrid::initMasks();
+	_resultMemo.init(resultMemoSize, memoWays);
+}
 
 void FastRater::setSolution(const char *solution) {
 	for(int i = 0; i < 81; ++ i) {
@@ -11,28 +181,410 @@ void FastRater::setSolution(const char *solution) {
 }
 
 FastRater::Score FastRater::rateHintMask(Mask128 mask) {
-	RaterState state{};
-	while(mask) {
-		Mask128 lb = mask.getLowestBit();
-		int cell = lb.getBitPos();
-		assignDigit(cell, _originalSolution[cell], state);
-		mask ^= lb;
+	RaterGrid grid;
+	grid.init();
+	forEachCell(mask, [this, &grid](int cell) {
+		grid.assignInstantly(cell, _originalSolution[cell]);
+	});
+	return rateGrid(grid, numeric_limits<Score>::max());
+}
+
+FastRater::Score FastRater::rate(const char *problem) {
+	return rateBounded(problem, numeric_limits<Score>::max());
+}
+
+//same as Rater::rateBounded
+FastRater::Score FastRater::rateBounded(const char *problem, Score threshold) {
+	RaterGrid grid;
+	grid.load(problem);
+	return rateGrid(grid, threshold);
+}
+
+FastRater::Score FastRater::rateGrid(RaterGrid &grid, Score threshold) {
+	unsigned iterations;
+	_totalWork = 0;
+	_workLimit = threshold;
+	_hashHistory.clear();
+	Result result = propagate(grid, iterations, false);
+	if(result == Result::Aborted)
+		return _totalWork;
+	if(result == Result::Invalid)
+		return -1;
+	if(_totalWork != 0)
+		return _totalWork;
+	else
+		return iterations - 1;
+}
+
+//naked singles and hidden singles.
+//When several moves hit the same cell, the first one in Rater's order wins
+//(naked singles, then rows, columns and blocks, each in ascending digit order).
+int FastRater::constraint_N(const Mask128 *candidates, Mask128 singles, Mask128 *assigned) {
+	Mask128 taken = singles;
+	rep(d, 9)
+		assigned[d] = candidates[d] & singles;
+	rep(type, 3) rep(d, 9) {
+		if(!candidates[d])
+			continue;
+		Mask128 hidden(0);
+		rep(i, 9) {
+			Mask128 m = candidates[d] & FastGrid::unitMasks[type * 9 + i];
+			if(m && !hasMultipleBits(m))
+				hidden |= m;
+		}
+		hidden &= ~taken;
+		assigned[d] |= hidden;
+		taken |= hidden;
 	}
-	return mainLoop(state);
+	return taken.countOneBits();
 }
 
-void FastRater::assignDigit(int cell, int digit, RaterState &state) {
-	assert(state.grid.digitMasks[digit].get(cell));
-	assert(state.solvedDigits[cell] == uint8_t(-1));
+static GridBase::Mask extractUnitMask(Mask128 m, int unit) {
+	GridBase::Mask mask = 0;
+	rep(index, 9) if(m.get(GridBase::unitCell(unit, index)))
+		mask |= 1 << index;
+	return mask;
+}
+
+//Box claim (box-line / line-box reduction)
+int FastRater::constraint_B(const Mask128 *candidates, Mask128 undetermined, const RaterGrid &grid, Mask128 *eliminated) {
+	int moves = 0;
+	rep(d, 9) {
+		Mask128 c = candidates[d], e(0);
+		if(c) {
+			rep(boxi, 9) {
+				Mask128 boxMask = FastGrid::unitMasks[18 + boxi];
+				Mask128 m = c & boxMask;
+				if(!hasMultipleBits(m))
+					continue;
+				rep(k, 3) {
+					Mask128 row = FastGrid::unitMasks[boxi / 3 * 3 + k];
+					Mask128 col = FastGrid::unitMasks[9 + boxi % 3 * 3 + k];
+					if(!(m & ~row))
+						e |= c & row & ~boxMask;
+					if(!(m & ~col))
+						e |= c & col & ~boxMask;
+				}
+			}
+			rep(line, 18) {
+				Mask128 lineMask = FastGrid::unitMasks[line];
+				Mask128 m = c & lineMask;
+				if(!hasMultipleBits(m))
+					continue;
+				rep(k, 3) {
+					Mask128 boxMask = FastGrid::unitMasks[18 + (line < 9 ? line / 3 * 3 + k : k * 3 + (line - 9) / 3)];
+					if(!(m & ~boxMask))
+						e |= c & boxMask & ~lineMask;
+				}
+			}
+		}
+		eliminated[d] = e;
+		moves += e.countOneBits();
+	}
+	if(moves == 0)
+		return 0;
+
+	//GsfGrid::commit skips a cell once it is determined, so if all the digits of a cell are eliminated,
+	//the digit eliminated last (in the order of processBoxLineReduction) remains.
+	Mask128 remaining(0);
+	rep(d, 9)
+		remaining |= grid.getCellDigitMask(d) & ~eliminated[d];
+	Mask128 wipedOut = undetermined & ~remaining;
+	if(wipedOut) {
+		RaterGrid::Mask seen[81] = {};
+		int lastDigit[81];
+		GridBase::processBoxLineReduction(
+			[candidates](int unit, int d) { return extractUnitMask(candidates[d], unit); },
+			[&](int cell, int d) {
+				if(wipedOut.get(cell) && !(seen[cell] >> d & 1)) {
+					seen[cell] |= 1 << d;
+					lastDigit[cell] = d;
+				}
+			}
+		);
+		forEachCell(wipedOut, [&](int cell) {
+			eliminated[lastDigit[cell]].unset(cell);
+		});
+	}
+	return moves;
+}
 
-	state.grid.assign(cell, digit);
+//same as Rater::makeTupleList
+void FastRater::makeTupleList(const RaterGrid &grid) {
+	Mask128 undetermined = grid.getUndeterminedMask();
+	Mask128 possible[9];
+	grid.getPossibleMasks(undetermined, possible);
 
-	state.solvedDigits[cell] = digit;
+	rep(n, 10)
+		_tuples[n].clear();
+	//cell tuples
+	forEachCell(undetermined, [&](int cell) {
+		RaterGrid::Mask mask = 0;
+		rep(d, 9) if(possible[d].get(cell))
+			mask |= 1 << d;
+		int count = countOneBits(mask);
+		if(count == 1) return;
+		for(int d : EachBit(mask))
+			_tuples[count].push_back(TupleEntry{ (uint8_t)cell, (uint8_t)d });
+	});
+	//unit tuples
+	rep(d, 9) rep(unit, 27) {
+		Mask128 m = possible[d] & FastGrid::unitMasks[unit];
+		int count = m.countOneBits();
+		if(count <= 1) continue;
+		if(unit < 18 && count <= 3) {
+			int box = GridBase::cellUnit(m.getBitPos(), 2);
+			if(!(m & ~FastGrid::unitMasks[box]))
+				continue;
+		}
+		forEachCell(m, [&](int cell) {
+			_tuples[count].push_back(TupleEntry{ (uint8_t)cell, (uint8_t)d });
+		});
+	}
 }
 
-FastRater::Score FastRater::mainLoop(RaterState &/*state*/) {
-	while(1) {
+//same as Rater::propstep. The moves are appended to "moves" instead of the grid.
+int FastRater::propstep(const RaterGrid &grid, vector<Move> &moves, SeenMemo &seenMemo, Counters &counters, int w, bool nested) {
+	assert(moves.empty());
+
+	Mask128 undetermined = grid.getUndeterminedMask();
+	Mask128 possible[9];
+	grid.getPossibleMasks(undetermined, possible);
 
+	const vector<TupleEntry> &tuples = _tuples[w];
+	int num = (int)tuples.size() / w;
+	bool error = false;
+	rep(i, num) {
+		int remCandidates = w;
+		rep(j, w) {
+			const TupleEntry &entry = tuples[i * w + j];
+			int cell = entry.cell, digit = entry.digit;
+			if(!undetermined.get(cell)) {
+				if(possible[digit].get(cell)) {
+					remCandidates = -1;
+					break;
+				} else {
+					--remCandidates;
+				}
+			} else if(!possible[digit].get(cell)) {
+				--remCandidates;
+			}
+		}
+		if(remCandidates == 0) {
+			error = true;
+			continue;
+		} else if(remCandidates == -1) {
+			continue;
+		}
+		rep(j, w) {
+			const TupleEntry &entry = tuples[i * w + j];
+			int cell = entry.cell, digit = entry.digit;
+			if(!undetermined.get(cell) || !possible[digit].get(cell))
+				continue;
+			switch(seenMemo.get(cell, digit)) {
+			case Solution:
+				break;
+			case Unknown:
+				break;
+			case Error:
+				--remCandidates;
+				break;
+			case NoInfo:
+				++counters.propositions;
+				RaterGrid cloned = grid;
+				cloned.assignInstantly(cell, digit);
+				unsigned iterations;
+				Result result = propagate(cloned, iterations, true);
+				counters.iterations += iterations;
+				if(result == Result::Solved) {
+					++counters.solutions;
+					moves.push_back(Move{ Move::ASSIGN, entry.cell, entry.digit });
+					seenMemo.set(cell, digit, Solution);
+					j = w;
+				} else if(result == Result::Invalid) {
+					--remCandidates;
+					if(!nested) {
+						++counters.contradictions;
+						moves.push_back(Move{ Move::ELIMINATE, entry.cell, entry.digit });
+					}
+					seenMemo.set(cell, digit, Error);
+				} else {
+					seenMemo.set(cell, digit, Unknown);
+				}
+				break;
+			}
+		}
+		if(remCandidates == 0)
+			error = true;
 	}
-	return Score();
+	if(error) {
+		moves.clear();
+		return -1;
+	} else {
+		return (int)moves.size();
+	}
+}
+
+//same as Rater::constraint_P. The moves are left in _moves.
+int FastRater::constraint_P(const RaterGrid &grid) {
+	makeTupleList(grid);
+	_moves.clear();
+
+	Counters counters;
+	_firstSeenMemo = SeenMemo();
+	for(int w = 2; w <= 9; ++w) {
+		int firstMoves = propstep(grid, _moves, _firstSeenMemo, counters, w, false);
+		if(firstMoves != 0)
+			goto done;
+	}
+
+	counters = Counters();
+	for(int m = 2; m <= 9; ++m) {
+		const vector<TupleEntry> &tuples = _tuples[m];
+		int num = (int)tuples.size() / m;
+		_seenMemos.assign(num * m, SeenMemo());
+		for(int w = 2; w <= m; ++w) {
+			rep(i, num) rep(j, m) {
+				const TupleEntry &entry = tuples[i * m + j];
+				SeenMemo &seenMemo = _seenMemos[i * m + j];
+				int cell = entry.cell, digit = entry.digit;
+				switch(seenMemo.get(cell, digit)) {
+				case Solution:
+					break;
+				case Error:
+					break;
+				default:
+					RaterGrid cloned = grid;
+					cloned.assignInstantly(cell, digit);
+					int saved_solutions = counters.solutions;
+					_nestedMoves.clear();
+					int k = propstep(cloned, _nestedMoves, seenMemo, counters, w, true);
+					_moves.insert(_moves.end(), _nestedMoves.begin(), _nestedMoves.end());
+					if(k < 0) {
+						++counters.contradictions;
+						_moves.push_back(Move{ Move::ELIMINATE, entry.cell, entry.digit });
+						seenMemo.set(cell, digit, Error);
+					} else if(k == 0) {
+						seenMemo.set(cell, digit, Unknown);
+					} else if(saved_solutions < counters.solutions) {
+						_moves.push_back(Move{ Move::ASSIGN, entry.cell, entry.digit });
+						seenMemo.set(cell, digit, Solution);
+						j = m;
+					}
+					break;
+				}
+			}
+			if(!_moves.empty())
+				goto done;
+		}
+	}
+done:
+	_totalWork += counters.calculateWork();
+	return (int)_moves.size();
+}
+
+void FastRater::commitMoves(RaterGrid &grid, const vector<Move> &moves) {
+	for(const Move &move : moves) {
+		if(move.type == Move::ASSIGN)
+			grid.assign(move.cell, move.digit);
+		else
+			grid.eliminate(move.cell, move.digit);
+	}
+}
+
+FastRater::Result FastRater::propagate(RaterGrid &grid, unsigned &iterations, bool nested) {
+	size_t historyBase = _hashHistory.size();
+
+	auto setResultMemo = [this, historyBase, &iterations](Result result) -> Result {
+		for(size_t i = historyBase; i < _hashHistory.size(); ++ i) {
+			const HistoryEntry &e = _hashHistory[i];
+			PropagateResult r;
+			r.result = result;
+			r.iterations = iterations - e.iterations;
+			r.totalWork = _totalWork - e.totalWork;
+			_resultMemo.insert(e.hash, r);
+		}
+		_hashHistory.resize(historyBase);
+		return result;
+	};
+
+	iterations = 0;
+	int moves;
+	do {
+		{
+			RaterGrid::Hash gridHash = grid.getHash();
+			if(!nested) gridHash ^= 1;
+			PropagateResult *r = _resultMemo.find(gridHash);
+			if(r != nullptr) {
+				Result result = r->result;
+				iterations += r->iterations;
+				_totalWork += r->totalWork;
+				return setResultMemo(result);
+			}
+			_hashHistory.push_back(HistoryEntry{ gridHash, iterations, _totalWork });
+		}
+
+		Mask128 undetermined = grid.getUndeterminedMask();
+		Mask128 candidates[9];
+		grid.getUnitCandidateMasks(undetermined, candidates);
+
+		Mask128 one(0), two(0);
+		rep(d, 9) {
+			two |= one & candidates[d];
+			one |= candidates[d];
+		}
+		if(undetermined & ~one)
+			return setResultMemo(Result::Invalid);
+		Mask128 singles = one & ~two;
+
+		if(iterations >= 0xffffffffU) {
+			cerr << "iterations >= 0xffffffffU" << endl;
+			break;
+		}
+		++iterations;
+
+		if(!undetermined) {
+			//verify
+			Mask128 filled(0);
+			rep(d, 9)
+				filled |= grid.getCellDigitMask(d);
+			if(FastGrid::mask81 & ~filled)
+				return setResultMemo(Result::Invalid);
+			rep(d, 9) for(const Mask128 &unitMask : FastGrid::unitMasks) {
+				if(hasMultipleBits(grid.getCellDigitMask(d) & unitMask))
+					return setResultMemo(Result::Invalid);
+			}
+			return setResultMemo(Result::Solved);
+		}
+
+		Mask128 changes[9];
+		moves = constraint_N(candidates, singles, changes);
+		if(moves > 0) {
+			grid.assignAll(changes);
+		} else {
+			moves = constraint_B(candidates, undetermined, grid, changes);
+			if(moves > 0) {
+				grid.eliminateAll(changes);
+			} else if(!nested) {
+				moves = constraint_P(grid);
+				if(_totalWork >= _workLimit) {
+					_hashHistory.resize(historyBase);
+					return Result::Aborted;
+				}
+				commitMoves(grid, _moves);
+			}
+		}
+	} while(moves > 0);
+
+	{
+		Mask128 undetermined = grid.getUndeterminedMask();
+		Mask128 possible[9];
+		grid.getPossibleMasks(undetermined, possible);
+		rep(d, 9) for(const Mask128 &unitMask : FastGrid::unitMasks) {
+			if(!(possible[d] & unitMask))
+				return setResultMemo(Result::Invalid);
+		}
+	}
+
+	return setResultMemo(Result::Unknown);
 }
@@ -1,28 +1,159 @@
 #pragma once
 #include "mask128.hpp"
 #include "fastgrid.hpp"
+#include "gridbase.hpp"
+#include "memotable.hpp"
 #include <cstdint>
 #include <cstring>
+#include <vector>
 
+//Bit-sliced version of Rater. It follows Rater's algorithm step by step and returns the same Score.
 class FastRater {
 public:
 	typedef long long Score;
+
+	//Same state as Rater::GsfGrid, but the cell masks are stored as digit planes.
+	//_cells.digitMasks[d] has the cells whose mask still contains d (determined cells keep their digit),
+	//_allowedMasks[d] has the cells whose three units still contain d.
+	class RaterGrid : public GridBase {
+		FastGrid _cells;
+		Mask128 _allowedMasks[9];
+		Mask _units[27];
+		Hash _hash;
+
+	public:
+		void init();
+		void load(const char *problem);
+
+		void assignInstantly(int cell, int digit);
+		void assign(int cell, int digit);
+		void eliminate(int cell, int digit);
+
+		void assignAll(const Mask128 *assigned);
+		void eliminateAll(const Mask128 *eliminated);
+
+		Mask128 getUndeterminedMask() const;
+		void getPossibleMasks(Mask128 undetermined, Mask128 *possible) const;
+		void getUnitCandidateMasks(Mask128 undetermined, Mask128 *candidates) const;
+		Mask128 getCellDigitMask(int d) const { return _cells.digitMasks[d]; }
+
+		Mask getCellMask(int cell) const;
+
+		Hash getHash() const { return _hash; }
+
+	private:
+		void applyMask(int cell, Mask mask);
+		void toggleUnits(int cell, int digit);
+		void updateAllowedMask(int digit);
+	};
+
+	explicit FastRater(size_t resultMemoSize = 10000, int memoWays = 1);
+
 	void setSolution(const char *solution);
 	Score rateHintMask(Mask128 mask);
 
+	Score rate(const char *problem);
+	Score rateBounded(const char *problem, Score threshold);
+
+	static int constraint_N(const Mask128 *candidates, Mask128 singles, Mask128 *assigned);
+	static int constraint_B(const Mask128 *candidates, Mask128 undetermined, const RaterGrid &grid, Mask128 *eliminated);
+
 private:
-	struct RaterState {
-		FastGrid grid;
-		uint8_t solvedDigits[81];
+	enum class Result {
+		Unknown,
+		Invalid,
+		Solved,
+		Aborted,
+	};
+
+	struct PropagateResult {
+		Result result;
+		unsigned iterations;
+		long long totalWork;
+	};
+
+public:
+	typedef ConcurrentMemoTable<PropagateResult> SharedMemo;
+
+	//uses a memo table shared with other FastRaters
+	void shareMemo(SharedMemo *shared) { _resultMemo.share(shared); }
+	void flushMemoStats() { _resultMemo.flushStats(); }
+	MemoTableStats getMemoStats() const { return _resultMemo.getStats(); }
 
-		RaterState() {
-			grid.init();
-			std::memset(solvedDigits, -1, sizeof solvedDigits);
+private:
+	struct Move {
+		enum MoveType : uint8_t {
+			ASSIGN,
+			ELIMINATE
+		} type;
+		uint8_t cell;
+		uint8_t digit;
+	};
+
+	struct TupleEntry {
+		uint8_t cell;
+		uint8_t digit;
+	};
+
+	enum Seen : uint8_t {
+		NoInfo,
+		Solution,
+		Error,
+		Unknown
+	};
+
+	struct SeenMemo {
+		Seen memo[81 * 9];
+
+		SeenMemo() { std::memset(memo, NoInfo, sizeof memo); }
+
+		Seen get(int cell, int digit) const { return memo[cell * 9 + digit]; }
+		void set(int cell, int digit, Seen seen) { memo[cell * 9 + digit] = seen; }
+	};
+
+	//same as Rater::Counters
+	struct Counters {
+		int iterations;
+		int propositions;
+		int solutions;
+		int contradictions;
+
+		Counters() : iterations(0), propositions(0), solutions(0), contradictions(0) {}
+
+		long long calculateWork() const {
+			if(propositions == 0)
+				return 0;
+			long long work = (long long)(iterations / 100) * propositions / (solutions + contradictions + 1);
+			if(work < 1000)
+				work = 1000LL * iterations / propositions / (solutions + contradictions + 1);
+			return work;
 		}
 	};
 
-	void assignDigit(int cell, int digit, RaterState &state);
-	Score mainLoop(RaterState &state);
+	struct HistoryEntry {
+		RaterGrid::Hash hash;
+		unsigned iterations;
+		long long totalWork;
+	};
+
+	void makeTupleList(const RaterGrid &grid);
+	int propstep(const RaterGrid &grid, std::vector<Move> &moves, SeenMemo &seenMemo, Counters &counters, int w, bool nested);
+	int constraint_P(const RaterGrid &grid);
+	static void commitMoves(RaterGrid &grid, const std::vector<Move> &moves);
+
+	Result propagate(RaterGrid &grid, unsigned &iterations, bool nested);
+	Score rateGrid(RaterGrid &grid, Score threshold);
 
 	uint8_t _originalSolution[81];
+
+	long long _totalWork;
+	long long _workLimit;
+	MemoTable<PropagateResult> _resultMemo;
+
+	//buffers reused between calls
+	std::vector<HistoryEntry> _hashHistory;
+	std::vector<TupleEntry> _tuples[10];
+	std::vector<Move> _moves, _nestedMoves;
+	SeenMemo _firstSeenMemo;
+	std::vector<SeenMemo> _seenMemos;
 };
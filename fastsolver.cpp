@@ -0,0 +1,208 @@
+#include "fastsolver.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+FastSolver::FastSolver(size_t resultMemoSize) : _randomize(false) {
+	FastGrid::initMasks();
+	_resultMemo.init(resultMemoSize);
+}
+
+//false if clues contradict each other
+bool FastSolver::load(const char *problem, CheckState &state) {
+	rep(cell, 81) {
+		int c = problem[cell];
+		if(c < '1' || '9' < c)
+			continue;
+		int digit = c - '1';
+		if(!state.grid.digitMasks[digit].get(cell))
+			return false;
+		UniquenessChecker::assignDigit(cell, digit, state);
+	}
+	return true;
+}
+
+long long FastSolver::countSolutions(const char *problem, long long limit) {
+	CheckState state;
+	if(!load(problem, state))
+		return 0;
+	return countRec(state, limit);
+}
+
+bool FastSolver::findSolution(const char *problem, char *solution, bool randomize) {
+	_randomize = randomize;
+	CheckState state;
+	if(load(problem, state) && findRec(state, solution))
+		return true;
+	fill(solution, solution + 81, '0');
+	return false;
+}
+
+//same search as UniquenessChecker::checkRec, with box-line reduction before guessing
+//(without it, a wrong guess on a problem with few clues can take a long time to fail)
+long long FastSolver::countRec(CheckState &state, long long limit) {
+	while(UniquenessChecker::resolveSolvedSquares(state) != 0)
+		;
+
+	uint64_t hash = state.computeHash();
+	if(const CountResult *r = _resultMemo.find(hash)) {
+		if(r->complete || r->count >= limit)
+			return min(r->count, limit);
+	}
+	auto setResultMemo = [this, hash, limit](long long count) {
+		_resultMemo.insert(hash, CountResult{ count, count < limit });
+		return count;
+	};
+
+	if(UniquenessChecker::resolveHiddenSingles(state) != 0)
+		return setResultMemo(countRec(state, limit));
+
+	int status = UniquenessChecker::checkStatus(state);
+	if(status <= 0)
+		return setResultMemo(status < 0 ? 0 : 1);
+
+	if(UniquenessChecker::resolveLockedCandidates(state) != 0)
+		return setResultMemo(countRec(state, limit));
+
+	pair<int, int> minTuple[9];
+	int minSize = UniquenessChecker::findMinTuple(state, minTuple);
+	long long total = 0;
+	rep(k, minSize) {
+		CheckState childState = state;
+		UniquenessChecker::assignDigit(minTuple[k].first, minTuple[k].second, childState);
+		total += countRec(childState, limit - total);
+		if(total >= limit)
+			break;
+	}
+	return setResultMemo(min(total, limit));
+}
+
+//The memo is used only to skip states without solutions.
+bool FastSolver::findRec(CheckState &state, char *solution) {
+	while(UniquenessChecker::resolveSolvedSquares(state) != 0)
+		;
+
+	uint64_t hash = state.computeHash();
+	if(const CountResult *r = _resultMemo.find(hash)) {
+		if(r->complete && r->count == 0)
+			return false;
+	}
+	auto setNoSolution = [this, hash]() {
+		_resultMemo.insert(hash, CountResult{ 0, true });
+		return false;
+	};
+
+	if(UniquenessChecker::resolveHiddenSingles(state) != 0)
+		return findRec(state, solution) || setNoSolution();
+
+	int status = UniquenessChecker::checkStatus(state);
+	if(status < 0)
+		return setNoSolution();
+	if(status == 0) {
+		rep(cell, 81)
+			solution[cell] = (char)('1' + state.solvedDigits[cell]);
+		return true;
+	}
+
+	if(UniquenessChecker::resolveLockedCandidates(state) != 0)
+		return findRec(state, solution) || setNoSolution();
+
+	pair<int, int> minTuple[9];
+	int minSize = UniquenessChecker::findMinTuple(state, minTuple);
+	if(_randomize)
+		shuffle(minTuple, minTuple + minSize, _randomEngine);
+	rep(k, minSize) {
+		CheckState childState = state;
+		UniquenessChecker::assignDigit(minTuple[k].first, minTuple[k].second, childState);
+		if(findRec(childState, solution))
+			return true;
+	}
+	return setNoSolution();
+}
+
+long long FastSolver::enumerateSolutions(const char *problem, long long limit, vector<string> &solutions) {
+	CheckState state;
+	if(!load(problem, state))
+		return 0;
+	return enumerateRec(state, limit, solutions);
+}
+
+//same as findRec, going on after a solution
+long long FastSolver::enumerateRec(CheckState &state, long long limit, vector<string> &solutions) {
+	while(UniquenessChecker::resolveSolvedSquares(state) != 0)
+		;
+
+	uint64_t hash = state.computeHash();
+	if(const CountResult *r = _resultMemo.find(hash)) {
+		if(r->complete && r->count == 0)
+			return 0;
+	}
+	auto setResult = [this, hash](long long count) {
+		if(count == 0)
+			_resultMemo.insert(hash, CountResult{ 0, true });
+		return count;
+	};
+
+	if(UniquenessChecker::resolveHiddenSingles(state) != 0)
+		return setResult(enumerateRec(state, limit, solutions));
+
+	int status = UniquenessChecker::checkStatus(state);
+	if(status < 0)
+		return setResult(0);
+	if(status == 0) {
+		string solution(81, '0');
+		rep(cell, 81)
+			solution[cell] = (char)('1' + state.solvedDigits[cell]);
+		solutions.push_back(solution);
+		return 1;
+	}
+
+	if(UniquenessChecker::resolveLockedCandidates(state) != 0)
+		return setResult(enumerateRec(state, limit, solutions));
+
+	pair<int, int> minTuple[9];
+	int minSize = UniquenessChecker::findMinTuple(state, minTuple);
+	long long total = 0;
+	rep(k, minSize) {
+		CheckState childState = state;
+		UniquenessChecker::assignDigit(minTuple[k].first, minTuple[k].second, childState);
+		total += enumerateRec(childState, limit - total, solutions);
+		if(total >= limit)
+			break;
+	}
+	return setResult(total);
+}
+
+//The first guess is the same as that of countRec and enumerateRec.
+//The eliminations of resolveLockedCandidates are not kept in the branches, so the guesses after it may differ.
+bool FastSolver::splitProblem(const char *problem, vector<string> &branches) {
+	CheckState state;
+	if(!load(problem, state))
+		return false;
+	while(1) {
+		while(UniquenessChecker::resolveSolvedSquares(state) != 0)
+			;
+		if(UniquenessChecker::resolveHiddenSingles(state) != 0)
+			continue;
+		if(UniquenessChecker::checkStatus(state) <= 0)
+			return false;
+		if(UniquenessChecker::resolveLockedCandidates(state) == 0)
+			break;
+	}
+
+	string cleared(81, '0');
+	rep(cell, 81) {
+		if(state.solvedDigits[cell] != uint8_t(-1))
+			cleared[cell] = (char)('1' + state.solvedDigits[cell]);
+	}
+	pair<int, int> minTuple[9];
+	int minSize = UniquenessChecker::findMinTuple(state, minTuple);
+	rep(k, minSize) {
+		string branch = cleared;
+		branch[minTuple[k].first] = (char)('1' + minTuple[k].second);
+		branches.push_back(branch);
+	}
+	return true;
+}
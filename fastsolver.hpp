@@ -0,0 +1,46 @@
+#pragma once
+#include "uniquenesschecker.hpp"
+#include "memotable.hpp"
+#include <random>
+#include <vector>
+#include <string>
+
+//Solver on the bitboard of UniquenessChecker (FastGrid), with the interface of Solver.
+//The solutions are counted up to a limit, instead of 0, 1 or 2 for two or more.
+class FastSolver {
+public:
+	typedef UniquenessChecker::CheckState CheckState;
+
+	explicit FastSolver(size_t resultMemoSize = 10000);
+
+	//same as Solver::solve: 0, 1, or 2 for two or more solutions
+	int solve(const char *problem) { return (int)countSolutions(problem, 2); }
+	//the number of solutions, or limit if there are limit or more (limit >= 1)
+	long long countSolutions(const char *problem, long long limit);
+	//for a problem with two or more solutions, the solution found may differ from that of Solver
+	bool findSolution(const char *problem, char *solution, bool randomize = false);
+	//appends the first limit solutions (or all of them if fewer) in the order of the search, and returns the number appended
+	long long enumerateSolutions(const char *problem, long long limit, std::vector<std::string> &solutions);
+	//For splitting the search: appends the problems of the branches of the first guess, in the order of the search,
+	//with the digits found before it as clues. Returns false if the problem is solved or invalid before guessing.
+	bool splitProblem(const char *problem, std::vector<std::string> &branches);
+
+	void setRandomEngine(std::default_random_engine re) { _randomEngine = re; }
+	const std::default_random_engine &getRandomEngine() const { return _randomEngine; }
+
+private:
+	//count is exact if complete, and otherwise at least the limit of the search that found it
+	struct CountResult {
+		long long count;
+		bool complete;
+	};
+
+	bool load(const char *problem, CheckState &state);
+	long long countRec(CheckState &state, long long limit);
+	bool findRec(CheckState &state, char *solution);
+	long long enumerateRec(CheckState &state, long long limit, std::vector<std::string> &solutions);
+
+	MemoTable<CountResult> _resultMemo;
+	bool _randomize;
+	std::default_random_engine _randomEngine;
+};
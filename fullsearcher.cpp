@@ -3,10 +3,11 @@
 #include <algorithm>
 #include <iostream>
 #include <cstdint>
+#include <limits>
 
-FullSearcher::FullSearcher(size_t memoSize, long long rateThreshold, Logger &outputLogger, Logger &infoLogger) :
-	_memoSize(memoSize), _rateThreshold(rateThreshold),
-	_outputLogger(outputLogger), _infoLogger(infoLogger) {
+FullSearcher::FullSearcher(size_t memoSize, long long rateThreshold, bool boundedRating, Logger &outputLogger, Logger &infoLogger) :
+	_memoSize(memoSize), _rateThreshold(rateThreshold), _boundedRating(boundedRating),
+	_outputLogger(outputLogger), _infoLogger(infoLogger), _ratingStore(nullptr) {
 
 	_checker.unsetSolution(_memoSize);
 }
@@ -27,13 +28,34 @@ void FullSearcher::searchStronglyUnique(Mask81 mask) {
 	std::fill(_curProblem, _curProblem + 81, '0');
 	_curProblem[81] = 0;
 
-	_checkedProblems = _noSolutionProblems = _uniqueSolutionProblems = 0;
+	_checkedProblems = _noSolutionProblems = _uniqueSolutionProblems = _storedRatings = 0;
+	_preFilter.resetCounters();
 
 	searchStronglyUniqueRec(0);
+	_rater.flushMemoStats();
+	_checker.flushMemoStats();
 
 	_infoLogger.log(
 		"search for ", mask.toBitString(), " ended\n",
-		"  checked: ", _checkedProblems, ", no sol: ", _noSolutionProblems, ", valid: ", _uniqueSolutionProblems);
+		"  checked: ", _checkedProblems, ", no sol: ", _noSolutionProblems, ", valid: ", _uniqueSolutionProblems,
+		", prefiltered: ", _preFilter.getRejected(), ", rated by the store: ", _storedRatings);
+}
+
+//ratings are not invariant under isomorphism, so only canonical problems use the store
+long long FullSearcher::rateProblem(bool &isLowerBound) {
+	long long threshold = _boundedRating ? _rateThreshold : std::numeric_limits<long long>::max();
+	bool useStore = _ratingStore != nullptr && _canonicalizer.canonicalizeProblem(_curProblem) == _curProblem;
+	long long rate;
+	isLowerBound = false;
+	if(useStore && _ratingStore->find(_curProblem, rate)) {
+		++ _storedRatings;
+		return rate;
+	}
+	rate = _rater.rateBounded(_curProblem, threshold);
+	isLowerBound = rate >= threshold;
+	if(useStore && rate < threshold)
+		_ratingStore->insert(_curProblem, rate);
+	return rate;
 }
 
 void FullSearcher::searchStronglyUniqueRec(int i) {
@@ -47,10 +69,14 @@ void FullSearcher::searchStronglyUniqueRec(int i) {
 			return;
 		} else if(status == 1) {
 			++ _uniqueSolutionProblems;
-			auto rate = _rater.rate(_curProblem);
+			if(_preFilter.reject(_curProblem, _rateThreshold))
+				return;
+			bool isLowerBound;
+			auto rate = rateProblem(isLowerBound);
+			//a lower bound is written with '+', as in rate and combine
 			if(rate >= _rateThreshold) {
-				_outputLogger.log(_curProblem, ' ', rate);
-				_infoLogger.log(_curProblem, ": ", rate);
+				_outputLogger.log(_curProblem, ' ', rate, isLowerBound ? "+" : "");
+				_infoLogger.log(_curProblem, ": ", rate, isLowerBound ? "+" : "");
 			}
 		}
 
@@ -2,22 +2,35 @@
 #include "mask81.hpp"
 #include "uniquenesschecker.hpp"
 #include "rater.hpp"
+#include "prefilter.hpp"
+#include "ratingstore.hpp"
+#include "canonicalizer.hpp"
 #include "logger.hpp"
 #include <vector>
 #include <cstdint>
 
 class FullSearcher {
 public:
-	FullSearcher(size_t memoSize, long long rateThreshold, Logger &outputLogger, Logger &infoLogger);
+	FullSearcher(size_t memoSize, long long rateThreshold, bool boundedRating, Logger &outputLogger, Logger &infoLogger);
 	void searchStronglyUnique(Mask81 mask);
+	void shareMemo(Rater::SharedMemo *raterMemo, UniquenessChecker::SharedMemo *checkerMemo) {
+		_rater.shareMemo(raterMemo);
+		_checker.shareMemo(checkerMemo);
+	}
+	//ratings of canonical problems are looked up in and added to the store
+	void setRatingStore(RatingStore *store) { _ratingStore = store; }
 
 private:
 	size_t _memoSize;
 	long long _rateThreshold;
+	bool _boundedRating;
 	Logger &_outputLogger, &_infoLogger;
 
 	UniquenessChecker _checker;
 	Rater _rater;
+	RatingPreFilter _preFilter;
+	RatingStore *_ratingStore;
+	Canonicalizer _canonicalizer;
 
 	std::vector<int> _hintPoses;
 	std::vector<int> _boxPattern;
@@ -27,6 +40,9 @@ private:
 	long long _checkedProblems;
 	long long _noSolutionProblems;
 	long long _uniqueSolutionProblems;
+	long long _storedRatings;
 
 	void searchStronglyUniqueRec(int i);
+	//isLowerBound: the rating stopped at the threshold (with boundedRating)
+	long long rateProblem(bool &isLowerBound);
 };
@@ -5,10 +5,12 @@
 using namespace std;
 
 mutex GridBase::_initDataMutex;
+atomic<bool> GridBase::_dataInitialized(false);
 
 GridBase::Hash GridBase::_hashCoeffs[81 + 27][9];
 GridBase::Hash GridBase::_initHashCells, GridBase::_initHashCellsAndUnits;
 char GridBase::_claimPattern[512];
+uint32_t GridBase::_boxLineDependencies[27];
 
 int GridBase::unitCell(int unit, int index) {
 	if(unit < 9) {	//row
@@ -40,6 +42,9 @@ int GridBase::cellUnitIndex(int cell, int type) {
 }
 
 void GridBase::initData() {
+	//called in hot paths (constraint_B etc.), so the lock is taken only until the data is ready
+	if(_dataInitialized.load(memory_order_acquire))
+		return;
 	lock_guard<mutex> lock(_initDataMutex);
 
 	if(_hashCoeffs[0][0] == 0) {
@@ -72,6 +77,21 @@ void GridBase::initData() {
 			_claimPattern[a | b | c] |= (j + 1) << 2;
 		}
 	}
+
+	//a box reads the lines crossing it, and a line reads the boxes it crosses
+	rep(unit, 27) {
+		uint32_t dependencies = 1U << unit;
+		rep(i, 3) {
+			if(unit >= 18)
+				dependencies |= 1U << ((unit - 18) / 3 * 3 + i) | 1U << (9 + (unit - 18) % 3 * 3 + i);
+			else if(unit < 9)
+				dependencies |= 1U << (18 + unit / 3 * 3 + i);
+			else
+				dependencies |= 1U << (18 + i * 3 + (unit - 9) / 3);
+		}
+		_boxLineDependencies[unit] = dependencies;
+	}
+	_dataInitialized.store(true, memory_order_release);
 }
 
 
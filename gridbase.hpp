@@ -2,6 +2,8 @@
 
 #include "util.hpp"
 #include <mutex>
+#include <atomic>
+#include <cstdint>
 
 class GridBase {
 public:
@@ -18,6 +20,7 @@ protected:
 
 private:
 	static std::mutex _initDataMutex;
+	static std::atomic<bool> _dataInitialized;
 
 	static Hash _hashCoeffs[81 + 27][9];
 	static Hash _initHashCells, _initHashCellsAndUnits;
@@ -34,8 +37,16 @@ public:
 	static int cellUnit(int cell, int type);
 	static int cellUnitIndex(int cell, int type);
 
+	//needsCheck(unit, d) tells if the reduction starting from the unit (a box or a line) has to be checked for d.
+	//A reduction that made no eliminations can be skipped until the masks of getBoxLineDependencies(unit) for d change.
+	template<typename GetUnitMask, typename Eliminate, typename NeedsCheck>
+	static int processBoxLineReduction(GetUnitMask getUnitMask, Eliminate eliminate, NeedsCheck needsCheck);
 	template<typename GetUnitMask, typename Eliminate>
-	static int processBoxLineReduction(GetUnitMask getUnitMask, Eliminate eliminate);
+	static int processBoxLineReduction(GetUnitMask getUnitMask, Eliminate eliminate) {
+		return processBoxLineReduction(getUnitMask, eliminate, [](int, int) { return true; });
+	}
+	//bit u is set if the reduction starting from unit reads the unit masks of unit u
+	static uint32_t getBoxLineDependencies(int unit) { return _boxLineDependencies[unit]; }
 
 private:
 	static int checkBoxRowPattern(Mask mask) {
@@ -49,18 +60,21 @@ private:
 	}
 
 	static char _claimPattern[512];
+	static uint32_t _boxLineDependencies[27];
 
 public:
 	static void makeSolutionMask(const char *solution, Mask *solutionMask);
 };
 
-template<typename GetUnitMask, typename Eliminate>
-int GridBase::processBoxLineReduction(GetUnitMask getUnitMask, Eliminate eliminate) {
+template<typename GetUnitMask, typename Eliminate, typename NeedsCheck>
+int GridBase::processBoxLineReduction(GetUnitMask getUnitMask, Eliminate eliminate, NeedsCheck needsCheck) {
 	initData();
 	int moves = 0;
 	for(int boxi = 0; boxi < 9; ++ boxi) {
 		int box = 18 + boxi;
 		for(int d = 0; d < 9; ++ d) {
+			if(!needsCheck(box, d))
+				continue;
 			Mask boxMask = getUnitMask(box, d);
 			int rowPos = checkBoxRowPattern(boxMask) - 1;
 			if(rowPos != -1) {
@@ -89,6 +103,8 @@ int GridBase::processBoxLineReduction(GetUnitMask getUnitMask, Eliminate elimina
 	for(int type = 1; type >= 0; --type) for(int linei = 0; linei < 9; ++ linei) {
 		int line = type * 9 + linei;
 		for(int d = 0; d < 9; ++ d) {
+			if(!needsCheck(line, d))
+				continue;
 			Mask lineMask = getUnitMask(line, d);
 			int boxPos = checkLinePattern(lineMask) - 1;
 			if(boxPos == -1) continue;
@@ -0,0 +1,120 @@
+#include "interleavedchecker.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+void InterleavedChecker::setSolution(const char *solution, size_t memoSize) {
+	rep(cell, 81)
+		_originalSolution[cell] = solution[cell] - '1';
+	_memoTable.init(memoSize);
+}
+
+void InterleavedChecker::areSolutionsUnique(const Mask128 *masks, int n, bool *results) {
+	if((int)_queries.size() < n)
+		_queries.resize(n);
+	rep(i, n) {
+		Query &query = _queries[i];
+		query.depth = 0;
+		query.result = -1;
+		query.state = CheckState();
+		for(Mask128 mask = masks[i]; mask; ) {
+			Mask128 lb = mask.getLowestBit();
+			int cell = lb.getBitPos();
+			UniquenessChecker::assignDigit(cell, _originalSolution[cell], query.state);
+			mask ^= lb;
+		}
+		startNode(query);
+	}
+	//round robin over the queries not done yet
+	int active = n;
+	while(active > 0) {
+		active = 0;
+		rep(i, n) {
+			Query &query = _queries[i];
+			if(query.result >= 0)
+				continue;
+			continueNode(query);
+			if(query.result < 0)
+				++ active;
+		}
+	}
+	rep(i, n)
+		results[i] = _queries[i].result == 1;
+}
+
+void InterleavedChecker::startNode(Query &query) {
+	while(UniquenessChecker::resolveSolvedSquares(query.state) != 0)
+		;
+	query.hash = query.state.computeHash();
+	_memoTable.prefetch(query.hash);
+}
+
+//the same steps as UniquenessChecker::checkRec (without locked candidates). A node that would recurse pushes a frame instead.
+void InterleavedChecker::continueNode(Query &query) {
+	if(auto it = _memoTable.find(query.hash)) {
+		returnResult(query, *it);
+		return;
+	}
+	auto pushFrame = [&query](bool branch) -> Frame & {
+		if((int)query.stack.size() == query.depth)
+			query.stack.emplace_back();
+		Frame &frame = query.stack[query.depth ++];
+		frame.branch = branch;
+		frame.hash = query.hash;
+		return frame;
+	};
+	CheckState &state = query.state;
+	if(UniquenessChecker::resolveHiddenSingles(state) != 0) {
+		pushFrame(false);
+		startNode(query);
+		return;
+	}
+	int status = UniquenessChecker::checkStatus(state);
+	if(status <= 0) {
+		int result = 0;
+		if(status == 0)
+			result = memcmp(state.solvedDigits, _originalSolution, sizeof _originalSolution) != 0 ? 2 : 1;
+		_memoTable.insert(query.hash, result);
+		returnResult(query, result);
+		return;
+	}
+	Frame &frame = pushFrame(true);
+	frame.state = state;
+	frame.size = UniquenessChecker::findMinTuple(state, frame.tuple);
+	int differentBranches = 0;
+	rep(k, frame.size) {
+		if(_originalSolution[frame.tuple[k].first] != frame.tuple[k].second)
+			swap(frame.tuple[differentBranches ++], frame.tuple[k]);
+	}
+	frame.next = 0;
+	frame.total = 0;
+	startChild(query);
+}
+
+void InterleavedChecker::startChild(Query &query) {
+	Frame &frame = query.stack[query.depth - 1];
+	query.state = frame.state;
+	const auto &p = frame.tuple[frame.next ++];
+	UniquenessChecker::assignDigit(p.first, p.second, query.state);
+	startNode(query);
+}
+
+//passes the result of a node to the frames, until a branch has another guess to try
+void InterleavedChecker::returnResult(Query &query, int result) {
+	while(query.depth > 0) {
+		Frame &frame = query.stack[query.depth - 1];
+		if(frame.branch) {
+			frame.total += result;
+			if(frame.total < 2 && frame.next < frame.size) {
+				startChild(query);
+				return;
+			}
+			result = frame.total;
+		}
+		_memoTable.insert(frame.hash, result);
+		-- query.depth;
+	}
+	query.result = result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "uniquenesschecker.hpp"
+#include "memotable.hpp"
+#include "mask128.hpp"
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+//isSolutionUnique of UniquenessChecker for several masks at once, for smr checkbench.
+//The searches (the same as UniquenessChecker::checkRec, on explicit stacks) take turns node by node,
+//and each prefetches the memo slot of its next node before passing the turn, so that the memo misses
+//of one search overlap the work of the others.
+class InterleavedChecker {
+public:
+	typedef UniquenessChecker::CheckState CheckState;
+
+	void setSolution(const char *solution, size_t memoSize);
+	void areSolutionsUnique(const Mask128 *masks, int n, bool *results);
+
+private:
+	//a node of checkRec: one that returns the result of the state after the singles (chain),
+	//or one that guesses (branch), with the state before the guesses
+	struct Frame {
+		bool branch;
+		uint64_t hash;
+		CheckState state;
+		std::pair<int, int> tuple[9];
+		int size, next, total;
+	};
+	struct Query {
+		std::vector<Frame> stack;
+		int depth;
+		CheckState state;
+		uint64_t hash;
+		int result;
+	};
+
+	//the steps of a query: from the start of a node to its hash (prefetched), and from there to the next node or the result
+	void startNode(Query &query);
+	void continueNode(Query &query);
+	void startChild(Query &query);
+	void returnResult(Query &query, int result);
+
+	uint8_t _originalSolution[81];
+	MemoTable<int> _memoTable;
+	std::vector<Query> _queries;
+};
@@ -3,6 +3,8 @@
 #include "mask81.hpp"
 #include "canonicalizer.hpp"
 #include "solver.hpp"
+#include "fastsolver.hpp"
+#include "batchsolver.hpp"
 #include "utilforcommands.hpp"
 
 #include <iostream>
@@ -72,7 +74,7 @@ void loadHintMasks(const string &maskListFilename, const string &maskListCacheFi
 	cout << hintMasks.size() << " masks loaded" << endl;
 }
 
-void loadSolutions(const string &solutionListFilename, const string &solutionListCacheFilename, const string &knownProblemListCacheFilename, vector<string> &solutions, unordered_set<string> &knownProblemSet) {
+void loadSolutions(const string &solutionListFilename, const string &solutionListCacheFilename, const string &knownProblemListCacheFilename, vector<string> &solutions, unordered_set<string> &knownProblemSet, bool useFastSolver, bool useBatchSolver) {
 	if(!solutionListCacheFilename.empty()) {
 		ifstream fcache(solutionListCacheFilename);
 		string sig;
@@ -100,18 +102,35 @@ void loadSolutions(const string &solutionListFilename, const string &solutionLis
 		unordered_set<string> solutionSet;
 		string grid;
 		Solver solver;
+		FastSolver fastSolver;
 		Canonicalizer canonicalizer;
 		int dups = 0;
+		vector<string> grids;
 		while(fin >> grid) {
 			if(grid.size() != 81) continue;
 			for(char &c : grid) if(c == '.') c = '0';
 			checkProblem(grid);
-
+			grids.push_back(grid);
+		}
+		//with --batchsolver, the first solutions of all the problems are found at once
+		vector<long long> counts;
+		vector<string> batchSolutions;
+		if(useBatchSolver)
+			BatchSolver().solve(grids, 1, counts, batchSolutions);
+		rep(i, grids.size()) {
+			const string &grid = grids[i];
 			string problem = canonicalizer.canonicalizeProblem(grid.c_str());
 			knownProblemSet.insert(problem);
 
 			char solution[82];
-			if(!solver.findSolution(grid.c_str(), solution))
+			bool found;
+			if(useBatchSolver) {
+				found = counts[i] > 0;
+				batchSolutions[i].copy(solution, 81);
+			} else {
+				found = useFastSolver ? fastSolver.findSolution(grid.c_str(), solution) : solver.findSolution(grid.c_str(), solution);
+			}
+			if(!found)
 				checkInput(false, grid);
 			solution[81] = 0;
 			string lexMin = canonicalizer.canonicalizeSolution(solution);
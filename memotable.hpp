@@ -1,53 +1,337 @@
 #pragma once
 #include <memory>
 #include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <type_traits>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include "util.hpp"
+
+struct MemoTableStats {
+	long long hits;
+	long long misses;
+	//misses where the slot held another key (or was being written)
+	long long collisions;
+	//inserts that replaced an entry of another key
+	long long evictions;
+
+	MemoTableStats() : hits(0), misses(0), collisions(0), evictions(0) {}
+
+	void add(const MemoTableStats &that) {
+		hits += that.hits;
+		misses += that.misses;
+		collisions += that.collisions;
+		evictions += that.evictions;
+	}
+
+	std::string toString() const {
+		long long lookups = hits + misses;
+		char hitRate[16] = "-";
+		if(lookups != 0)
+			std::snprintf(hitRate, sizeof hitRate, "%.1f%%", hits * 100.0 / lookups);
+		return "lookups: " + std::to_string(lookups) + ", hits: " + std::to_string(hits) + " (" + std::string(hitRate) + ")"
+			+ ", misses: " + std::to_string(misses) + ", collisions: " + std::to_string(collisions) + ", evictions: " + std::to_string(evictions);
+	}
+};
+
+//Memo table shared by threads. Each slot is protected by a sequence counter (seqlock):
+//a writer makes it odd while writing, and a reader drops what it read if the counter changed.
+//Inserts never wait; if another thread is writing the same slot, the insert is dropped.
+//Usually used through MemoTable::share.
+template<typename Val>
+class ConcurrentMemoTable {
+public:
+	typedef unsigned long long Key;
+
+	ConcurrentMemoTable() : _size(0), _hits(0), _misses(0), _collisions(0) {}
+
+	//init and clear are not thread safe
+	void init(size_t size) {
+		_size = size;
+		_table.reset(new Slot[size]);
+		clear();
+	}
+
+	void clear() {
+		for(size_t i = 0; i < _size; ++ i) {
+			Slot &slot = _table[i];
+			slot.seq.store(0, std::memory_order_relaxed);
+			slot.key.store(Key(-1), std::memory_order_relaxed);
+			for(auto &word : slot.val)
+				word.store(0, std::memory_order_relaxed);
+		}
+		_hits = _misses = _collisions = 0;
+	}
+
+	size_t size() const { return _size; }
+
+	bool find(Key key, Val &val, MemoTableStats &stats) const {
+		if(_size == 0)
+			return false;
+		const Slot &slot = _table[key % _size];
+		uint64_t seq = slot.seq.load(std::memory_order_acquire);
+		Key slotKey = slot.key.load(std::memory_order_relaxed);
+		uint64_t words[ValWords];
+		for(int i = 0; i < ValWords; ++ i)
+			words[i] = slot.val[i].load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		bool torn = (seq & 1) != 0 || slot.seq.load(std::memory_order_relaxed) != seq;
+		if(torn || slotKey != key) {
+			++ stats.misses;
+			if(torn || slotKey != Key(-1))
+				++ stats.collisions;
+			return false;
+		}
+		std::memcpy(&val, words, sizeof(Val));
+		++ stats.hits;
+		return true;
+	}
+
+	void insert(Key key, const Val &val, MemoTableStats &stats) {
+		if(_size == 0)
+			return;
+		Slot &slot = _table[key % _size];
+		uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+		if((seq & 1) != 0 || !slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed))
+			return;
+		std::atomic_thread_fence(std::memory_order_release);
+		uint64_t words[ValWords] = {};
+		std::memcpy(words, &val, sizeof(Val));
+		Key slotKey = slot.key.load(std::memory_order_relaxed);
+		if(slotKey != Key(-1) && slotKey != key)
+			++ stats.evictions;
+		slot.key.store(key, std::memory_order_relaxed);
+		for(int i = 0; i < ValWords; ++ i)
+			slot.val[i].store(words[i], std::memory_order_relaxed);
+		slot.seq.store(seq + 2, std::memory_order_release);
+	}
+
+	//counters are kept by the users (see MemoTable::flushStats) and summed here
+	void addStats(const MemoTableStats &stats) {
+		_hits += stats.hits;
+		_misses += stats.misses;
+		_collisions += stats.collisions;
+	}
+
+	MemoTableStats getStats() const {
+		MemoTableStats stats;
+		stats.hits = _hits;
+		stats.misses = _misses;
+		stats.collisions = _collisions;
+		return stats;
+	}
+
+private:
+	static_assert(std::is_trivially_copyable<Val>::value, "ConcurrentMemoTable needs a trivially copyable value");
+	static const int ValWords = (sizeof(Val) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	struct Slot {
+		std::atomic<uint64_t> seq;
+		std::atomic<Key> key;
+		std::atomic<uint64_t> val[ValWords];
+	};
+
+	size_t _size;
+	std::unique_ptr<Slot[]> _table;
+	std::atomic<long long> _hits, _misses, _collisions;
+};
 
 template<typename Val>
 class MemoTable {
 public:
 	typedef unsigned long long Key;
 
+	//tag: the key without the bits given by its slot (key / size, or key >> bucket bits), and the epoch
+	//of the insert in the bits freed by that (at least one). An entry is valid only in the current epoch.
+	//So the epoch takes no room in an entry, and the key is kept whole (but one bit with a single slot or bucket).
 	struct KeyVal {
-		Key key;
+		Key tag;
 		Val val;
 	};
 
-	MemoTable() : _size(0) {}
+	MemoTable() : _size(0), _elements(0), _ways(1), _bucketMask(0), _quotientBits(63), _maxEpoch(1), _epoch(1), _epochTag(0), _shared(nullptr) {}
 
-	void init(size_t size) {
-		_size = size;
-		_table.reset(new KeyVal[size]);
+	//makes a private table (and stops sharing).
+	//ways == 1: direct-mapped, the entry for a key is at key % size.
+	//ways > 1: set-associative. The number of buckets of ways entries is a power of two (at most size entries in total).
+	//  Each bucket is kept in most recently used order, and the least recently used entry is replaced.
+	//Re-init with the same size and ways reuses the allocation and costs only a clear.
+	void init(size_t size, int ways = 1) {
+		ways = std::max(ways, 1);
+		size_t bucketMask = 0;
+		if(ways > 1) {
+			size_t buckets = 0;
+			if(size >= (size_t)ways) {
+				buckets = 1;
+				while(buckets * 2 * ways <= size)
+					buckets *= 2;
+			}
+			bucketMask = buckets - 1;
+			size = buckets * ways;
+		}
+		bool reuse = _table && _shared == nullptr && size == _size && ways == _ways;
+		_ways = ways;
+		_bucketMask = bucketMask;
+		_shared = nullptr;
+		int slotBits = 0;
+		while(slotBits < 63 && (Key(2) << slotBits) <= (ways > 1 ? bucketMask + 1 : size))
+			++ slotBits;
+		slotBits = std::max(slotBits, 1);
+		_quotientBits = 64 - slotBits;
+		_maxEpoch = slotBits >= 32 ? ~uint32_t(0) : (uint32_t(1) << slotBits) - 1;
+		if(!reuse) {
+			_size = size;
+			_table.reset(new KeyVal[size]);
+			std::memset(_table.get(), 0, size * sizeof(KeyVal));
+			_epoch = 0;
+		}
 		clear();
 	}
 
+	//O(1): starts a new epoch, and the entries of the old ones are treated as empty.
+	//The table is actually cleared only when the epoch wraps around (after 2^(slot bits) - 1 epochs, 2^32 - 1 at most).
 	void clear() {
-		std::memset(_table.get(), -1, _size * sizeof(KeyVal));
+		if(_epoch ++ == _maxEpoch) {
+			std::memset(_table.get(), 0, _size * sizeof(KeyVal));
+			_epoch = 1;
+		}
+		_epochTag = Key(_epoch) << _quotientBits;
 		_elements = 0;
+		_stats = MemoTableStats();
 	}
 
-	size_t size() const { return _size; }
+	//Uses the shared table instead of the private one until the next init.
+	//The results stored must depend only on the key, as other threads read them.
+	void share(ConcurrentMemoTable<Val> *shared) {
+		_size = 0;
+		_table.reset();
+		_elements = 0;
+		_shared = shared;
+		_stats = MemoTableStats();
+	}
+
+	//adds the counters of lookups into the shared table to it
+	void flushStats() {
+		if(_shared != nullptr) {
+			_shared->addStats(_stats);
+			_stats = MemoTableStats();
+		}
+	}
+
+	size_t size() const { return _shared != nullptr ? _shared->size() : _size; }
 	size_t numElements() const { return _elements; }
+	int ways() const { return _ways; }
+	//counters since the last init / clear
+	const MemoTableStats &getStats() const { return _stats; }
 
 	Val *find(Key key) {
+		if(_shared != nullptr)
+			return _shared->find(key, _sharedVal, _stats) ? &_sharedVal : nullptr;
 		if(_size == 0)
 			return nullptr;
-		KeyVal &p = _table[key % _size];
-		if(p.key == key)
+		if(_ways > 1)
+			return findInBucket(key);
+		Key quotient = key / _size;
+		KeyVal &p = _table[key - quotient * _size];
+		if(p.tag == makeTag(quotient)) {
+			++ _stats.hits;
 			return &p.val;
-		else
+		} else {
+			++ _stats.misses;
+			if(isCurrent(p))
+				++ _stats.collisions;
 			return nullptr;
+		}
+	}
+
+	//loads the slot (or the bucket) of key of the private table into the cache, for a find or insert of it soon
+	void prefetch(Key key) const {
+		if(_shared == nullptr && _size != 0)
+			prefetchForRead(_ways > 1 ? &_table[(key & _bucketMask) * _ways] : &_table[key % _size]);
 	}
 
 	void insert(Key key, const Val &val) {
+		if(_shared != nullptr) {
+			_shared->insert(key, val, _stats);
+			return;
+		}
 		if(_size == 0)
 			return;
-		KeyVal &kv = _table[key % _size];
-		if(kv.key == Key(-1)) ++ _elements;
-		kv = KeyVal{ key, val };
+		if(_ways > 1) {
+			insertToBucket(key, val);
+			return;
+		}
+		Key quotient = key / _size;
+		KeyVal &kv = _table[key - quotient * _size];
+		Key tag = makeTag(quotient);
+		if(!isCurrent(kv))
+			++ _elements;
+		else if(kv.tag != tag)
+			++ _stats.evictions;
+		kv = KeyVal{ tag, val };
 	}
 
 private:
+	Key makeTag(Key quotient) const { return (quotient & ((Key(1) << _quotientBits) - 1)) | _epochTag; }
+	bool isCurrent(const KeyVal &kv) const { return (kv.tag >> _quotientBits) == _epoch; }
+	Key getBucketTag(Key key) const { return makeTag(key >> (64 - _quotientBits)); }
+	KeyVal *getBucket(Key key) { return &_table[(key & _bucketMask) * _ways]; }
+
+	//Entries of the current epoch are always in front of older ones, since inserts and hits move them to the front.
+	//moves bucket[i] to the front
+	void moveToFront(KeyVal *bucket, int i) {
+		KeyVal kv = bucket[i];
+		std::memmove(bucket + 1, bucket, i * sizeof(KeyVal));
+		bucket[0] = kv;
+	}
+
+	Val *findInBucket(Key key) {
+		KeyVal *bucket = getBucket(key);
+		Key tag = getBucketTag(key);
+		for(int i = 0; i < _ways; ++ i) {
+			if(bucket[i].tag == tag) {
+				++ _stats.hits;
+				if(i != 0)
+					moveToFront(bucket, i);
+				return &bucket[0].val;
+			}
+		}
+		++ _stats.misses;
+		if(isCurrent(bucket[_ways - 1]))
+			++ _stats.collisions;
+		return nullptr;
+	}
+
+	void insertToBucket(Key key, const Val &val) {
+		KeyVal *bucket = getBucket(key);
+		Key tag = getBucketTag(key);
+		int i = 0;
+		while(i < _ways - 1 && isCurrent(bucket[i]) && bucket[i].tag != tag)
+			++ i;
+		if(!isCurrent(bucket[i]))
+			++ _elements;
+		else if(bucket[i].tag != tag)
+			++ _stats.evictions;
+		bucket[i] = KeyVal{ tag, val };
+		if(i != 0)
+			moveToFront(bucket, i);
+	}
+
 	size_t _size;
 	size_t _elements;
+	int _ways;
+	size_t _bucketMask;
+	//the bits of the quotient in a tag, and the epoch in the bits above them
+	int _quotientBits;
+	uint32_t _maxEpoch;
+	uint32_t _epoch;
+	Key _epochTag;
 	std::unique_ptr<KeyVal[]> _table;
+	MemoTableStats _stats;
+
+	ConcurrentMemoTable<Val> *_shared;
+	//copy of the value found in the shared table (find returns a pointer to it)
+	Val _sharedVal;
 };
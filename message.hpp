@@ -10,6 +10,11 @@ struct WorkerConfig {
 	std::pair<int, int> digitCountBounds;
 	int verboseness;
 	int randomSolution;
+	int fastRater;
+	int boundedRating;
+	int sharedMemo;
+	int memoWays;
+	int lockedCandidates;
 };
 
 struct WorkMessage {
@@ -32,6 +37,8 @@ struct ResponceMessage {
 
 	std::string problem;
 	long long rate;
+	//rate is a lower bound (bounded rating stopped at the threshold)
+	bool isLowerBound = false;
 	std::string info;
 	std::vector<int> validProblemCounts;
 };
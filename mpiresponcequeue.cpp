@@ -17,9 +17,13 @@ void MPIResponceQueue::enqueue(const ResponceMessage &message) {
 	case ResponceMessage::Type::WorkerIsIdle:
 		break;
 	case ResponceMessage::Type::FoundProblem:
+	{
 		assert(message.problem.size() == 81);
 		send(message.problem.c_str(), MPI_CHAR, 81);
 		send(&message.rate, MPI_LONG_LONG);
+		int isLowerBound = message.isLowerBound ? 1 : 0;
+		send(&isLowerBound, MPI_INT);
+	}
 		break;
 	case ResponceMessage::Type::LogInfo:
 	{
@@ -61,6 +65,9 @@ ResponceMessage MPIResponceQueue::dequeue() {
 		recv(problem, MPI_CHAR, 81);
 		message.problem = string(problem, problem + 81);
 		recv(&message.rate, MPI_LONG_LONG);
+		int isLowerBound = 0;
+		recv(&isLowerBound, MPI_INT);
+		message.isLowerBound = isLowerBound != 0;
 	}
 		break;
 	case ResponceMessage::Type::LogInfo:
@@ -0,0 +1,62 @@
+#include "prefilter.hpp"
+#include "fastgrid.hpp"
+#include "util.hpp"
+
+RatingPreFilter::RatingPreFilter() : _checked(0), _rejected(0) {
+	FastGrid::initMasks();
+}
+
+bool RatingPreFilter::reject(const char *problem, Score threshold) {
+	++ _checked;
+	Score rate;
+	if(!rateWithoutPropositions(problem, rate) || rate >= threshold)
+		return false;
+	++ _rejected;
+	return true;
+}
+
+//same loop as FastRater::propagate without the memo and constraint_P
+bool RatingPreFilter::rateWithoutPropositions(const char *problem, Score &rate) {
+	FastRater::RaterGrid grid;
+	grid.load(problem);
+
+	unsigned iterations = 0;
+	while(1) {
+		Mask128 undetermined = grid.getUndeterminedMask();
+		Mask128 candidates[9];
+		grid.getUnitCandidateMasks(undetermined, candidates);
+
+		Mask128 one(0), two(0);
+		rep(d, 9) {
+			two |= one & candidates[d];
+			one |= candidates[d];
+		}
+		if(undetermined & ~one)
+			return false;
+
+		++ iterations;
+
+		if(!undetermined) {
+			Mask128 filled(0);
+			rep(d, 9)
+				filled |= grid.getCellDigitMask(d);
+			if(FastGrid::mask81 & ~filled)
+				return false;
+			rep(d, 9) for(const Mask128 &unitMask : FastGrid::unitMasks) {
+				if((grid.getCellDigitMask(d) & unitMask).countOneBits() > 1)
+					return false;
+			}
+			rate = iterations - 1;
+			return true;
+		}
+
+		Mask128 changes[9];
+		if(FastRater::constraint_N(candidates, one & ~two, changes) > 0) {
+			grid.assignAll(changes);
+		} else if(FastRater::constraint_B(candidates, undetermined, grid, changes) > 0) {
+			grid.eliminateAll(changes);
+		} else {
+			return false;
+		}
+	}
+}
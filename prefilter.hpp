@@ -0,0 +1,26 @@
+#pragma once
+#include "fastrater.hpp"
+
+//Cheap stage before Rater.
+//If naked/hidden singles and box/line reduction alone solve a problem, Rater never reaches constraint_P
+//and its rating is just the number of propagation rounds - 1. That number is computed here exactly,
+//so problems rejected by this filter are exactly the ones Rater would rate below the threshold.
+class RatingPreFilter {
+public:
+	typedef long long Score;
+
+	RatingPreFilter();
+
+	//true if the problem surely rates below threshold
+	bool reject(const char *problem, Score threshold);
+	//false if propositions are needed (or the problem has no solution)
+	static bool rateWithoutPropositions(const char *problem, Score &rate);
+
+	long long getChecked() const { return _checked; }
+	long long getRejected() const { return _rejected; }
+	void resetCounters() { _checked = _rejected = 0; }
+
+private:
+	long long _checked;
+	long long _rejected;
+};
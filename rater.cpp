@@ -2,11 +2,11 @@
 #include "rater.hpp"
 #include <iostream>
 #include <vector>
-#include <tuple>
 #include <memory>
 #include <algorithm>
 #include <random>
 #include <cassert>
+#include <limits>
 
 using namespace std;
 
@@ -18,6 +18,10 @@ void Rater::GsfGrid::init() {
 	_moves.clear();
 	initData();
 	_hash = getInitHashCellsAndUnits();
+	_changedCells[0] = ~0ULL;
+	_changedCells[1] = (1ULL << (81 - 64)) - 1;
+	std::fill(_changedDigits, _changedDigits + 27, FullMask());
+	std::fill(_changedBoxLineDigits, _changedBoxLineDigits + 27, FullMask());
 }
 
 void Rater::GsfGrid::load(const char * problem) {
@@ -36,10 +40,15 @@ void Rater::GsfGrid::load(const char * problem) {
 	}
 }
 
-Rater::GsfGrid Rater::GsfGrid::clone() const {
-	GsfGrid g = *this;
-	g._moves.clear();
-	return g;
+void Rater::GsfGrid::copyFrom(const GsfGrid &that) {
+	std::copy(that._cells, that._cells + 81, _cells);
+	std::copy(that._units, that._units + 27, _units);
+	std::copy(&that._unitMasks[0][0], &that._unitMasks[0][0] + 27 * 9, &_unitMasks[0][0]);
+	_hash = that._hash;
+	std::copy(that._changedCells, that._changedCells + 2, _changedCells);
+	std::copy(that._changedDigits, that._changedDigits + 27, _changedDigits);
+	std::copy(that._changedBoxLineDigits, that._changedBoxLineDigits + 27, _changedBoxLineDigits);
+	_moves.clear();
 }
 
 void Rater::GsfGrid::assign(int cell, int digit) {
@@ -55,13 +64,14 @@ void Rater::GsfGrid::eliminate(int cell, int digit) {
 //sudoku.ĉ̂ƕԂl̈ӖႤ̂Œ
 int Rater::GsfGrid::commit() {
 	int moves = 0;
+	//only the first of the same moves is applied
+	uint64_t seen[(2 * 81 * 9 + 63) / 64] = {};
 	rep(i, _moves.size()) {
 		const Move &move = _moves[i];
-		bool unique = true;
-		rep(j, i)
-			unique &= _moves[j] != move;
-		if(!unique) continue;
 		int cell = move.cell, digit = move.digit;
+		int index = (move.type * 81 + cell) * 9 + digit;
+		if(seen[index / 64] >> (index % 64) & 1) continue;
+		seen[index / 64] |= 1ULL << (index % 64);
 		++moves;
 		if(isDetermined(cell))
 			continue;
@@ -75,6 +85,8 @@ int Rater::GsfGrid::commit() {
 			break;
 		}
 		Mask changed = _cells[cell] & ~mask;
+		if(_trail != nullptr)
+			_trail->push(cell, _cells[cell]);
 		_cells[cell] &= mask;
 		updateUnitMask(cell, changed);
 		changeCellHash(cell, changed);
@@ -118,6 +130,14 @@ void Rater::GsfGrid::updateUnitMaskSub(int unit, int index, Mask undeterminedMas
 void Rater::GsfGrid::updateUnitMask(int cell, Mask changedMask) {
 	int row = cell / 9, col = cell % 9, block = row / 3 * 3 + col / 3;
 	int blockindex = (row % 3) * 3 + (col % 3);
+	//called whenever the cell or one of its units changes
+	_changedCells[cell / 64] |= 1ULL << (cell % 64);
+	_changedDigits[row] |= changedMask;
+	_changedDigits[9 + col] |= changedMask;
+	_changedDigits[18 + block] |= changedMask;
+	_changedBoxLineDigits[row] |= changedMask;
+	_changedBoxLineDigits[9 + col] |= changedMask;
+	_changedBoxLineDigits[18 + block] |= changedMask;
 	Mask cellMask = _cells[cell];
 	Mask undeterminedMask;
 	if(isSingleBitOrZero(cellMask)) {
@@ -145,6 +165,8 @@ void Rater::GsfGrid::changeUnitHash(int unit, Mask changed) {
 
 void Rater::GsfGrid::setMask(int cell, Mask mask) {
 	Mask changed = _cells[cell] ^ mask;
+	if(_trail != nullptr)
+		_trail->push(cell, _cells[cell]);
 	_cells[cell] = mask;
 	updateUnitMask(cell, changed);
 	changeCellHash(cell, changed);
@@ -156,6 +178,8 @@ void Rater::GsfGrid::propagateMask(int cell, Mask mask) {
 	//oOIȋc
 	rep(type, 3) {
 		int unit = cellUnit(cell, type);
+		if(_trail != nullptr)
+			_trail->push(81 + unit, _units[unit]);
 		_units[unit] ^= mask;
 		changeUnitHash(unit, mask);
 	}
@@ -168,6 +192,24 @@ void Rater::GsfGrid::propagateMask(int cell, Mask mask) {
 	}
 }
 
+void Rater::GsfGrid::restore(const Checkpoint &checkpoint) {
+	_trail->undo(checkpoint.trailSize, [this](int index, Mask old) {
+		if(index < 81) {
+			//all the digits, as the cell may become undetermined again
+			Mask changed = _cells[index] | old;
+			_cells[index] = old;
+			updateUnitMask(index, changed);
+		} else {
+			int unit = index - 81;
+			Mask changed = _units[unit] ^ old;
+			_units[unit] = old;
+			rep(i, 9)
+				updateUnitMask(unitCell(unit, i), changed);
+		}
+	});
+	_hash = checkpoint.hash;
+}
+
 Rater::GsfGrid::Mask Rater::GsfGrid::getUnderminedMask(int cell) const {
 	Mask mask = _cells[cell];
 	rep(type, 3)
@@ -228,11 +270,15 @@ Rater::GsfGrid::Hash Rater::GsfGrid::getHash() const {
 }
 
 //hidden singles
+//Only the unit masks changed since the last call are checked (the others had no singles then).
 int Rater::constraint_N(GsfGrid &grid) {
 	int moves = 0;
-	rep(unit, 27) rep(d, 9) {
+	rep(unit, 27) for(int d : EachBit(grid.getChangedDigits(unit))) {
 		GsfGrid::Mask mask = grid.getUnitMask(unit, d);
-		if(mask == 0 || (mask & (mask - 1)) != 0) continue;
+		if(mask == 0 || (mask & (mask - 1)) != 0) {
+			grid.clearChangedDigit(unit, d);
+			continue;
+		}
 		int index = findFirstBitPos(mask);
 		int cell = GsfGrid::unitCell(unit, index);
 		grid.assign(cell, d);
@@ -243,53 +289,142 @@ int Rater::constraint_N(GsfGrid &grid) {
 
 //Box claim (box-line / line-box reduction)
 //郆jbgƐɑ΂Ǎ₪1̃jbgɎ܂ꍇ́Ãjbĝ̐eliminateł
+//Skips the reductions whose unit masks have not changed since the last call that made no moves.
 int Rater::constraint_B(GsfGrid &grid) {
-	return GsfGrid::processBoxLineReduction(
+	GsfGrid::Mask changedDigits[27];
+	rep(unit, 27) {
+		changedDigits[unit] = 0;
+		for(int u : EachBit(GsfGrid::getBoxLineDependencies(unit)))
+			changedDigits[unit] |= grid.getChangedBoxLineDigits(u);
+	}
+	int moves = GsfGrid::processBoxLineReduction(
 		[&grid](int unit, int d) { return grid.getUnitMask(unit, d); },
-		[&grid](int cell, int d) { grid.eliminate(cell, d); }
+		[&grid](int cell, int d) { grid.eliminate(cell, d); },
+		[&changedDigits](int unit, int d) { return (changedDigits[unit] >> d & 1) != 0; }
 	);
+	if(moves == 0)
+		grid.clearChangedBoxLineDigits();
+	return moves;
 }
 
 //uZn̌₪cĂv܂
 //ujbgɂ鐔̌ꏊnv
 //܂Ƃ߂n-tupleƌĂԁB
 //܂AguessƂ n ƂȂ́B
+//Updates the tuples of tupleList for the cells changed since the last call (see TupleList).
 void Rater::makeTupleList(const GsfGrid &grid, TupleList &tupleList) {
-	bool claimPattern[512] = {};
-	for(int i = 0; i < 9; i += 3) {
-		claimPattern[1 << (i + 0) | 1 << (i + 1)] = true;
-		claimPattern[1 << (i + 0) | 1 << (i + 2)] = true;
-		claimPattern[1 << (i + 1) | 1 << (i + 2)] = true;
-		claimPattern[1 << (i + 0) | 1 << (i + 1) | 1 << (i + 2)] = true;
-	}
-
-	tupleList.init();
-	//cell tuples
-	rep(cell, 81) if(!grid.isDetermined(cell)) {
-		int count = 0;
-		rep(d, 9) if(grid.isPossible(cell, d))
-			++count;
-		if(count == 1) continue;
-		rep(d, 9) if(grid.isPossible(cell, d))
-			tupleList.tuples[count].push_back(TupleEntry{ cell, d });
+	static const struct ClaimPattern {
+		bool claim[512];
+		ClaimPattern() : claim() {
+			for(int i = 0; i < 9; i += 3) {
+				claim[1 << (i + 0) | 1 << (i + 1)] = true;
+				claim[1 << (i + 0) | 1 << (i + 2)] = true;
+				claim[1 << (i + 1) | 1 << (i + 2)] = true;
+				claim[1 << (i + 0) | 1 << (i + 1) | 1 << (i + 2)] = true;
+			}
+		}
+	} claimPattern;
+
+	//cell tuples, and the unit patterns changed by the cells
+	uint64_t changedUnits[4] = {};
+	rep(cell, 81) {
+		GsfGrid::Mask possible = grid.getCellMask(cell);
+		uint64_t determined = grid.isDetermined(cell) ? 1 : 0;
+		uint64_t &determinedWord = tupleList.determined[cell / 64];
+		if(possible == tupleList.possible[cell] && determined == (determinedWord >> (cell % 64) & 1))
+			continue;
+		int size = determined ? 0 : countOneBits(possible);
+		if(size == 1)
+			size = 0;
+		uint8_t &cellSize = tupleList.cellSizes[cell];
+		tupleList.cellsBySize[cellSize][cell / 64] &= ~(1ULL << (cell % 64));
+		cellSize = (uint8_t)size;
+		tupleList.cellsBySize[cellSize][cell / 64] |= 1ULL << (cell % 64);
+		rep(type, 3) {
+			int unit = GsfGrid::cellUnit(cell, type);
+			int index = GsfGrid::cellUnitIndex(cell, type);
+			for(int d : EachBit(possible ^ tupleList.possible[cell])) {
+				tupleList.patterns[d][unit] ^= 1 << index;
+				changedUnits[(d * 27 + unit) / 64] |= 1ULL << ((d * 27 + unit) % 64);
+			}
+		}
+		tupleList.possible[cell] = possible;
+		determinedWord = (determinedWord & ~(1ULL << (cell % 64))) | determined << (cell % 64);
 	}
 	//unit tuples
-	rep(d, 9) rep(unit, 27) {
-		int count = 0;
-		unsigned pattern = 0;
-		rep(i, 9) if(grid.isPossible(GsfGrid::unitCell(unit, i), d)) {
-			++count;
-			pattern |= 1U << i;
-		}
+	rep(word, 4) for(int bit : EachBit64(changedUnits[word])) {
+		int i = word * 64 + bit;
+		int d = i / 27, unit = i % 27;
+		GsfGrid::Mask pattern = tupleList.patterns[d][unit];
+		int size = countOneBits(pattern);
 		//constraint_N  constraint_B ̑ΏۂɂȂ̂͏
-		if(count <= 1) continue;
-		if(unit < 18 && claimPattern[pattern]) continue;
-		rep(i, 9) {
-			int cell = GsfGrid::unitCell(unit, i);
-			if(grid.isPossible(cell, d))
-				tupleList.tuples[count].push_back(TupleEntry{ cell, d });
+		if(size <= 1 || (unit < 18 && claimPattern.claim[pattern]))
+			size = 0;
+		uint8_t &unitSize = tupleList.unitSizes[d][unit];
+		tupleList.unitsBySize[unitSize][word] &= ~(1ULL << bit);
+		unitSize = (uint8_t)size;
+		tupleList.unitsBySize[unitSize][word] |= 1ULL << bit;
+	}
+	std::fill(tupleList.listed, tupleList.listed + 10, false);
+}
+
+//the entries of the n-tuples, cell tuples first, and then unit tuples by digit and unit
+void Rater::TupleList::list(int n) {
+	if(listed[n])
+		return;
+	listed[n] = true;
+	vector<TupleEntry> &entries = tuples[n];
+	entries.clear();
+	rep(word, 2) for(int bit : EachBit64(cellsBySize[n][word])) {
+		int cell = word * 64 + bit;
+		for(int d : EachBit(possible[cell]))
+			entries.push_back(TupleEntry{ cell, d });
+	}
+	rep(word, 4) for(int bit : EachBit64(unitsBySize[n][word])) {
+		int i = word * 64 + bit;
+		int d = i / 27, unit = i % 27;
+		for(int index : EachBit(patterns[d][unit]))
+			entries.push_back(TupleEntry{ GsfGrid::unitCell(unit, index), d });
+	}
+}
+
+//Evaluates in parallel the propositions that propstep(w) on the top level may need.
+//Nested propagate depends only on the grid, so the results are the same whichever worker computes them.
+void Rater::evaluatePropositions(const GsfGrid &grid, const TupleList &tupleList, const TupleList::SeenMemo &seenMemo, int w) {
+	vector<TupleEntry> &entries = _propositionEntries;
+	entries.clear();
+	bool added[81 * 9] = {};
+	int num = tupleList.getNumEntries(w) / w;
+	rep(i, num) {
+		const TupleEntry *tuple = &tupleList.tuples[w][i * w];
+		bool solved = false;
+		rep(j, w) {
+			if(grid.isDetermined(tuple[j].cell) && grid.getDigit(tuple[j].cell) == tuple[j].digit)
+				solved = true;
+		}
+		if(solved)
+			continue;
+		rep(j, w) {
+			int cell = tuple[j].cell, digit = tuple[j].digit;
+			if(grid.isDetermined(cell) || !grid.isPossible(cell, digit) || seenMemo.get(cell, digit) != TupleList::NoInfo)
+				continue;
+			if(added[cell * 9 + digit])
+				continue;
+			added[cell * 9 + digit] = true;
+			entries.push_back(tuple[j]);
 		}
 	}
+
+	_propositionResults.resize(81 * 9);
+	_pool->run((int)entries.size(), [this, &grid, &entries](int task, int worker) {
+		const TupleEntry &entry = entries[task];
+		Rater &rater = getWorkerRater(worker);
+		GsfGrid &cloned = rater._propositionGrid;
+		cloned.copyFrom(grid);
+		cloned.assignInstantly(entry.cell, entry.digit);
+		PropositionResult &r = _propositionResults[entry.cell * 9 + entry.digit];
+		r.result = rater.propagate(cloned, r.iterations, true);
+	});
 }
 
 //ew-tupleɑ΂Aguessʂ{eNjbN݂̂ŉĂ݂B
@@ -297,8 +432,12 @@ void Rater::makeTupleList(const GsfGrid &grid, TupleList &tupleList) {
 int Rater::propstep(GsfGrid &grid, TupleList &tupleList, TupleList::SeenMemo &seenMemo, Counters &counters, int w, bool nested) {
 	assert(grid.getNumMoves() == 0);
 
+	if(!nested && _pool)
+		evaluatePropositions(grid, tupleList, seenMemo, w);
+
 	int num = tupleList.getNumEntries(w) / w;
 	bool error = false;
+	bool propositionGridLoaded = false;
 	rep(i, num) {
 		int remCandidates = w;
 		rep(j, w) {
@@ -336,10 +475,34 @@ int Rater::propstep(GsfGrid &grid, TupleList &tupleList, TupleList::SeenMemo &se
 				break;
 			case TupleList::NoInfo:
 				++counters.propositions;
-				GsfGrid cloned = grid.clone();
-				cloned.assignInstantly(cell, digit);
+				if(_profiling) {
+					if(nested)
+						++ _profile.secondLevelPropositions[_profileTupleWidth];
+					else
+						++ _profile.firstLevelPropositions[w];
+				}
+				Result result;
 				unsigned iterations;
-				Result result = propagate(cloned, iterations, true);
+				if(!nested && _pool) {
+					const PropositionResult &r = _propositionResults[cell * 9 + digit];
+					result = r.result;
+					iterations = r.iterations;
+				} else {
+					if(!propositionGridLoaded) {
+						_propositionGrid.copyFrom(grid);
+						//with the undo trail, the grid is copied once and each proposition is undone after it
+						_propositionTrail.clear();
+						_propositionGrid.setTrail(_useUndoTrail ? &_propositionTrail : nullptr);
+						propositionGridLoaded = _useUndoTrail;
+					}
+					GsfGrid::Checkpoint checkpoint = _propositionGrid.getCheckpoint();
+					_propositionGrid.assignInstantly(cell, digit);
+					result = propagate(_propositionGrid, iterations, true);
+					if(_useUndoTrail) {
+						_propositionGrid.restore(checkpoint);
+						_propositionGrid.setNumMoves(0);
+					}
+				}
 				counters.iterations += iterations;
 				if(result == Result::Solved) {
 					++counters.solutions;
@@ -371,18 +534,73 @@ int Rater::propstep(GsfGrid &grid, TupleList &tupleList, TupleList::SeenMemo &se
 	}
 }
 
+//second-level propositions starting from the entries of the i-th m-tuple.
+//grid is not changed. The moves are added to movesGrid (which may be grid itself).
+void Rater::propstepTuple(const GsfGrid &grid, GsfGrid &movesGrid, TupleList &tupleList, vector<TupleList::SeenMemo> &seenMemos, Counters &counters, int m, int w, int i) {
+	GsfGrid &cloned = _tupleGrid;
+	bool clonedLoaded = false;
+	rep(j, m) {
+		const TupleEntry &entry = tupleList.tuples[m][i * m + j];
+		TupleList::SeenMemo &seenMemo = seenMemos[i * m + j];
+		int cell = entry.cell, digit = entry.digit;
+		switch(seenMemo.get(cell, digit)) {
+		case TupleList::Solution:
+			break;
+		case TupleList::Error:
+			break;
+		default:
+			if(!clonedLoaded) {
+				cloned.copyFrom(grid);
+				//same as in propstep
+				_tupleTrail.clear();
+				cloned.setTrail(_useUndoTrail ? &_tupleTrail : nullptr);
+				clonedLoaded = _useUndoTrail;
+			}
+			GsfGrid::Checkpoint checkpoint = cloned.getCheckpoint();
+			cloned.assignInstantly(cell, digit);
+			if(_profiling) {
+				++ _profile.secondLevelGuesses[m];
+				_profileTupleWidth = m;
+			}
+			//propstep̐ŐɓB̔p
+			int saved_solutions = counters.solutions;
+			int k = propstep(cloned, tupleList, seenMemo, counters, w, true);
+			//propstepcloned gridɑ΂ĂmoveRs[
+			movesGrid.copyMoves(cloned);
+			if(_useUndoTrail) {
+				cloned.restore(checkpoint);
+				cloned.setNumMoves(0);
+			}
+			if(k < 0) {
+				++counters.contradictions;
+				movesGrid.eliminate(cell, digit);
+				seenMemo.set(cell, digit, TupleList::Error);
+			} else if(k == 0) {
+				seenMemo.set(cell, digit, TupleList::Unknown);
+			} else if(saved_solutions < counters.solutions) {
+				movesGrid.assign(cell, digit);
+				seenMemo.set(cell, digit, TupleList::Solution);
+				j = m;	//[v𔲂(w-tupleI)
+			}
+			break;
+		}
+	}
+}
+
 int Rater::constraint_P(GsfGrid &grid) {
 	assert(grid.getNumMoves() == 0);
 
-	TupleList tupleList;
+	TupleList &tupleList = _tupleList;
 	makeTupleList(grid, tupleList);
 
 //	int w1 = -1, w2 = -1;
 
 	Counters counters;
 	int firstMoves = 0;
-	TupleList::SeenMemo firstSeenMemo;
+	TupleList::SeenMemo &firstSeenMemo = _firstSeenMemo;
+	firstSeenMemo = TupleList::SeenMemo();
 	for(int w = 2; w <= 9; ++w) {
+		tupleList.list(w);
 		firstMoves = propstep(grid, tupleList, firstSeenMemo, counters, w, false);
 		if(firstMoves == -2)
 			return -2;
@@ -392,44 +610,29 @@ int Rater::constraint_P(GsfGrid &grid) {
 		}
 	}
 
-	//2iKguess
+	//2iKguess (all the tuples were listed above)
 	counters = Counters();
 	for(int m = 2; m <= 9; ++m) {
 		int num = tupleList.getNumEntries(m) / m;
-		vector<TupleList::SeenMemo> seenMemos(num * m);
+		vector<TupleList::SeenMemo> &seenMemos = _seenMemos;
+		seenMemos.assign(num * m, TupleList::SeenMemo());
 		for(int w = 2; w <= m; ++w) {
-			rep(i, num) rep(j, m) {
-				const TupleEntry &entry = tupleList.tuples[m][i * m + j];
-				TupleList::SeenMemo &seenMemo = seenMemos[i * m + j];
-				int cell = entry.cell, digit = entry.digit;
-				switch(seenMemo.get(cell, digit)) {
-				case TupleList::Solution:
-					break;
-				case TupleList::Error:
-					break;
-				default:
-					GsfGrid cloned = grid.clone();
-					cloned.assignInstantly(cell, digit);
-					//propstep̐ŐɓB̔p
-					int saved_solutions = counters.solutions;
-					int k = propstep(cloned, tupleList, seenMemo, counters, w, true);
-					if(k == -2)
-						return -2;
-					//propstepcloned gridɑ΂ĂmoveRs[
-					grid.copyMoves(cloned);
-					if(k < 0) {
-						++counters.contradictions;
-						grid.eliminate(cell, digit);
-						seenMemo.set(cell, digit, TupleList::Error);
-					} else if(k == 0) {
-						seenMemo.set(cell, digit, TupleList::Unknown);
-					} else if(saved_solutions < counters.solutions) {
-						grid.assign(cell, digit);
-						seenMemo.set(cell, digit, TupleList::Solution);
-						j = m;	//[v𔲂(w-tupleI)
-					}
-					break;
+			if(_pool) {
+				//tuples are independent of each other, and merging in order gives the same moves as the sequential loop
+				if((int)_movesGrids.size() < num)
+					_movesGrids.resize(num);
+				_tupleCounters.assign(num, Counters());
+				_pool->run(num, [this, &grid, m, w](int i, int worker) {
+					_movesGrids[i].copyFrom(grid);
+					getWorkerRater(worker).propstepTuple(grid, _movesGrids[i], _tupleList, _seenMemos, _tupleCounters[i], m, w, i);
+				});
+				rep(i, num) {
+					grid.copyMoves(_movesGrids[i]);
+					counters.add(_tupleCounters[i]);
 				}
+			} else {
+				rep(i, num)
+					propstepTuple(grid, grid, tupleList, seenMemos, counters, m, w, i);
 			}
 //			w1 = m, w2 = w;
 			if(grid.getNumMoves() > 0)
@@ -445,17 +648,19 @@ done:
 }
 
 Rater::Result Rater::propagate(GsfGrid &grid, unsigned &iterations, bool nested) {
-	vector<tuple<GsfGrid::Hash, unsigned, long long> > hashHistory;
+	//the nested propagations push their states above these
+	size_t historyBase = _hashHistory.size();
 
-	auto setResultMemo = [this, &grid, nested, &iterations, &hashHistory](Result result) -> Result {
-		for(auto p : hashHistory) {
+	auto setResultMemo = [this, &iterations, historyBase](Result result) -> Result {
+		for(size_t i = historyBase; i < _hashHistory.size(); ++ i) {
+			const HistoryEntry &e = _hashHistory[i];
 			PropagateResult r;
 			r.result = result;
-			r.iterations = iterations - std::get<1>(p);
-			r.totalWork = _totalWork - std::get<2>(p);
-			_resultMemo.insert(std::get<0>(p), r);
+			r.iterations = iterations - e.iterations;
+			r.totalWork = _totalWork - e.totalWork;
+			_resultMemo.insert(e.hash, r);
 		}
-		hashHistory.clear();
+		_hashHistory.resize(historyBase);
 		return result;
 	};
 
@@ -469,17 +674,19 @@ Rater::Result Rater::propagate(GsfGrid &grid, unsigned &iterations, bool nested)
 				iterations += r->iterations;
 				_totalWork += r->totalWork;
 				setResultMemo(r->result);
-				grid.init();
 				return r->result;
 			}
-			hashHistory.emplace_back(gridHash, iterations, _totalWork);
+			_hashHistory.push_back(HistoryEntry{ gridHash, iterations, _totalWork });
 		}
 
-		int undeterminedCells = 0;
+		//naked singles. Only the changed cells are checked, as the others were undetermined and had 2 or more candidates.
 		int moves = 0;
-		rep(cell, 81) {
-			if(grid.isDetermined(cell))
+		rep(word, 2) for(int bit : EachBit64(grid.getChangedCells(word))) {
+			int cell = word * 64 + bit;
+			if(grid.isDetermined(cell)) {
+				grid.clearChangedCell(cell);
 				continue;
+			}
 			GsfGrid::Mask cellMask = grid.getCellMask(cell);
 			if(cellMask == 0) {
 				return setResultMemo(Result::Invalid);
@@ -487,7 +694,7 @@ Rater::Result Rater::propagate(GsfGrid &grid, unsigned &iterations, bool nested)
 				grid.assign(cell, findFirstBitPos(cellMask));
 				++moves;
 			} else {
-				++undeterminedCells;
+				grid.clearChangedCell(cell);
 			}
 		}
 
@@ -496,29 +703,50 @@ Rater::Result Rater::propagate(GsfGrid &grid, unsigned &iterations, bool nested)
 			break;
 		}
 		++iterations;
+		if(_profiling) {
+			++ _profile.iterations;
+			_profile.nakedSingles += moves;
+		}
 
-		if(undeterminedCells == 0 && moves == 0) {
+		bool solved = moves == 0;
+		for(int cell = 0; solved && cell < 81; ++ cell)
+			solved = grid.isDetermined(cell);
+		if(solved) {
 			//verify
-			GsfGrid g; g.init();
-			rep(cell, 81) {
-				int digit = grid.getDigit(cell);
-				if(!g.isPossible(cell, digit)) {
-					return setResultMemo(Result::Invalid);
+			if(!isKnownSolution(grid)) {
+				GsfGrid g; g.init();
+				rep(cell, 81) {
+					int digit = grid.getDigit(cell);
+					if(!g.isPossible(cell, digit)) {
+						return setResultMemo(Result::Invalid);
+					}
+					g.assignInstantly(cell, digit);
 				}
-				g.assignInstantly(cell, digit);
 			}
 			return setResultMemo(Result::Solved);
 		}
 
-		moves += constraint_N(grid);
+		int hiddenSingles = constraint_N(grid);
+		moves += hiddenSingles;
+		if(_profiling)
+			_profile.hiddenSingles += hiddenSingles;
 		if(moves == 0) {
 			moves += constraint_B(grid);
+			if(_profiling)
+				_profile.boxLineMoves += moves;
 			if(moves == 0 && !nested) {
 				moves += constraint_P(grid);
+				if(_totalWork >= _workLimit) {
+					//the rest is not evaluated, so these states must not be memoized
+					_hashHistory.resize(historyBase);
+					return Result::Aborted;
+				}
 			}
 		}
 	} while(grid.commit() > 0);
 
+	if(allowsKnownSolution(grid))
+		return setResultMemo(Result::Unknown);
 	rep(unit, 27) {
 		GsfGrid::Mask mask = 0;
 		rep(index, 9) {
@@ -533,12 +761,174 @@ Rater::Result Rater::propagate(GsfGrid &grid, unsigned &iterations, bool nested)
 	return setResultMemo(Result::Unknown);
 }
 
+Rater::Rater(size_t resultMemoSize, int intraThreads, int memoWays) :
+	_totalWork(0), _workLimit(numeric_limits<long long>::max()), _useUndoTrail(false), _profiling(false), _profileTupleWidth(0), _hasSolution(false) {
+	_resultMemo.init(resultMemoSize, memoWays);
+	if(intraThreads > 1) {
+		_pool.reset(new WorkerPool(intraThreads));
+		rep(i, intraThreads - 1)
+			_helpers.emplace_back(new Rater(resultMemoSize, 1, memoWays));
+	}
+}
+
+MemoTableStats Rater::getMemoStats() const {
+	MemoTableStats stats = _resultMemo.getStats();
+	for(auto &helper : _helpers)
+		stats.add(helper->getMemoStats());
+	return stats;
+}
+
+void Rater::setUndoTrail(bool use) {
+	_useUndoTrail = use;
+	for(auto &helper : _helpers)
+		helper->setUndoTrail(use);
+}
+
+Rater::Profile::Profile() : iterations(0), nakedSingles(0), hiddenSingles(0), boxLineMoves(0) {
+	std::fill(firstLevelPropositions, firstLevelPropositions + 10, 0);
+	std::fill(secondLevelGuesses, secondLevelGuesses + 10, 0);
+	std::fill(secondLevelPropositions, secondLevelPropositions + 10, 0);
+}
+
+void Rater::Profile::add(const Profile &that) {
+	iterations += that.iterations;
+	nakedSingles += that.nakedSingles;
+	hiddenSingles += that.hiddenSingles;
+	boxLineMoves += that.boxLineMoves;
+	rep(w, 10) {
+		firstLevelPropositions[w] += that.firstLevelPropositions[w];
+		secondLevelGuesses[w] += that.secondLevelGuesses[w];
+		secondLevelPropositions[w] += that.secondLevelPropositions[w];
+	}
+	memo.add(that.memo);
+}
+
+//widths without propositions are omitted
+string Rater::Profile::toString() const {
+	string first, second;
+	rep(w, 10) {
+		if(firstLevelPropositions[w] != 0)
+			first += " w" + to_string(w) + "=" + to_string(firstLevelPropositions[w]);
+		if(secondLevelGuesses[w] != 0)
+			second += " w" + to_string(w) + "=" + to_string(secondLevelGuesses[w]) + "/" + to_string(secondLevelPropositions[w]);
+	}
+	string s = "iterations: " + to_string(iterations) + ", naked singles: " + to_string(nakedSingles)
+		+ ", hidden singles: " + to_string(hiddenSingles) + ", box-line: " + to_string(boxLineMoves)
+		+ ", propositions:" + (first.empty() ? " -" : first) + ", second level (guesses/propositions):" + (second.empty() ? " -" : second);
+	return s + ", memo hits: " + to_string(memo.hits) + ", misses: " + to_string(memo.misses);
+}
+
+void Rater::setProfiling(bool on) {
+	_profiling = on;
+	for(auto &helper : _helpers)
+		helper->setProfiling(on);
+}
+
+void Rater::resetProfile() {
+	_profile = Profile();
+	_profileMemoBase = getMemoStats();
+	for(auto &helper : _helpers)
+		helper->resetProfile();
+}
+
+//The memo counters are the lookups since resetProfile, so they are taken from the memo stats of this Rater only (which include the helpers).
+Rater::Profile Rater::getProfile() const {
+	Profile profile = _profile;
+	for(auto &helper : _helpers) {
+		Profile helperProfile = helper->getProfile();
+		helperProfile.memo = MemoTableStats();
+		profile.add(helperProfile);
+	}
+	MemoTableStats stats = getMemoStats();
+	profile.memo.hits = stats.hits - _profileMemoBase.hits;
+	profile.memo.misses = stats.misses - _profileMemoBase.misses;
+	profile.memo.collisions = stats.collisions - _profileMemoBase.collisions;
+	profile.memo.evictions = stats.evictions - _profileMemoBase.evictions;
+	return profile;
+}
+
+void Rater::shareMemo(SharedMemo *shared) {
+	_resultMemo.share(shared);
+	for(auto &helper : _helpers)
+		helper->shareMemo(shared);
+}
+
+void Rater::flushMemoStats() {
+	_resultMemo.flushStats();
+	for(auto &helper : _helpers)
+		helper->flushMemoStats();
+}
+
 Rater::Score Rater::rate(const char *problem) {
-	GsfGrid grid;
-	grid.load(problem);
+	return rateBounded(problem, numeric_limits<Score>::max());
+}
+
+//Stops as soon as the rating is known to be threshold or more, and then returns a lower bound (>= threshold) of the rating.
+//Ratings below threshold are exact. The problem should have a solution (otherwise the exact rating would be -1).
+Rater::Score Rater::rateBounded(const char *problem, Score threshold) {
+	_grid.load(problem);
+	return rateGrid(_grid, threshold);
+}
+
+Rater::Score Rater::rateWithSolution(const char *problem, const char *solution, Score threshold) {
+	setKnownSolution(solution);
+	Score score = rateBounded(problem, threshold);
+	setKnownSolution(nullptr);
+	return score;
+}
+
+//nullptr unsets it. The solution has to be a valid grid, as grids equal to it are taken as solved.
+void Rater::setKnownSolution(const char *solution) {
+	_hasSolution = solution != nullptr;
+	if(_hasSolution) {
+		GsfGrid::Mask unitDigits[27] = {};
+		rep(cell, 81) {
+			int d = solution[cell] - '1';
+			bool valid = 0 <= d && d < 9;
+			rep(type, 3) {
+				GsfGrid::Mask &digits = unitDigits[GsfGrid::cellUnit(cell, type)];
+				valid = valid && (digits >> d & 1) == 0;
+				digits |= 1 << d;
+			}
+			if(!valid) {
+				cerr << "invalid solution: " << string(solution, 81) << endl;
+				abort();
+			}
+			_solution[cell] = (uint8_t)d;
+		}
+	}
+	for(auto &helper : _helpers)
+		helper->setKnownSolution(solution);
+}
+
+bool Rater::isKnownSolution(const GsfGrid &grid) const {
+	if(!_hasSolution)
+		return false;
+	rep(cell, 81) {
+		if(grid.getCellMask(cell) != 1 << _solution[cell])
+			return false;
+	}
+	return true;
+}
+
+//if every cell can still be its digit in the solution, every unit has all the digits
+bool Rater::allowsKnownSolution(const GsfGrid &grid) const {
+	if(!_hasSolution)
+		return false;
+	rep(cell, 81) {
+		if(!grid.isPossible(cell, _solution[cell]))
+			return false;
+	}
+	return true;
+}
+
+Rater::Score Rater::rateGrid(GsfGrid &grid, Score threshold) {
 	unsigned iterations;
 	_totalWork = 0;
+	_workLimit = threshold;
 	Result result = propagate(grid, iterations, false);
+	if(result == Result::Aborted)
+		return _totalWork;
 	if(result == Result::Invalid)
 		return -1;
 	if(_totalWork != 0)
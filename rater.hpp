@@ -1,7 +1,13 @@
 #pragma once
 #include "gridbase.hpp"
 #include "memotable.hpp"
+#include "workerpool.hpp"
+#include "undotrail.hpp"
 #include <vector>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <cstdint>
 
 class Rater {
 public:
@@ -13,8 +19,6 @@ public:
 			} type;
 			int cell;
 			int digit;
-
-			bool operator!=(const Move &that) const { return type != that.type || cell != that.cell || digit != that.digit; }
 		};
 
 		//Z mask  getMask ʂĎ擾B
@@ -24,11 +28,21 @@ public:
 		Mask _unitMasks[27][9];
 		std::vector<Move> _moves;
 		Hash _hash;
+		//what may have changed since the checks of propagate last found nothing there:
+		//cells for naked singles, digits of each unit for hidden singles (constraint_N),
+		//and digits of each unit for box-line reduction (constraint_B)
+		uint64_t _changedCells[2];
+		Mask _changedDigits[27];
+		Mask _changedBoxLineDigits[27];
+		UndoTrail *_trail;
 
 	public:
+		GsfGrid() : _trail(nullptr) {}
+
 		void init();
 		void load(const char *problem);
-		GsfGrid clone() const;
+		//copies the state without the moves. The buffer of the moves is kept, so this does not allocate.
+		void copyFrom(const GsfGrid &that);
 
 		void assign(int cell, int digit);
 		void eliminate(int cell, int digit);
@@ -58,12 +72,29 @@ public:
 		Mask getCellMask(int cell) const;
 		Mask getUnitMask(int unit, int d) const;
 
+		uint64_t getChangedCells(int word) const { return _changedCells[word]; }
+		void clearChangedCell(int cell) { _changedCells[cell / 64] &= ~(1ULL << (cell % 64)); }
+		Mask getChangedDigits(int unit) const { return _changedDigits[unit]; }
+		void clearChangedDigit(int unit, int d) { _changedDigits[unit] &= ~(1 << d); }
+		Mask getChangedBoxLineDigits(int unit) const { return _changedBoxLineDigits[unit]; }
+		void clearChangedBoxLineDigits() { std::fill(_changedBoxLineDigits, _changedBoxLineDigits + 27, 0); }
+
 		int getNumMoves() const;
 		void setNumMoves(int size);
 		void copyMoves(const GsfGrid &that);
 
 	public:
 		Hash getHash() const;
+
+		//Same as SolverGrid::Checkpoint. The cell masks and the unit masks (_units) are logged, and the rest is derived from them.
+		//The moves are not restored.
+		struct Checkpoint {
+			size_t trailSize;
+			Hash hash;
+		};
+		void setTrail(UndoTrail *trail) { _trail = trail; }
+		Checkpoint getCheckpoint() const { return Checkpoint{ _trail != nullptr ? _trail->size() : 0, _hash }; }
+		void restore(const Checkpoint &checkpoint);
 	};
 
 private:
@@ -71,6 +102,7 @@ private:
 		Unknown,
 		Invalid,
 		Solved,
+		Aborted,
 	};
 
 	struct PropagateResult {
@@ -80,6 +112,8 @@ private:
 	};
 
 public:
+	typedef ConcurrentMemoTable<PropagateResult> SharedMemo;
+
 	static int constraint_N(GsfGrid &grid);
 	static int constraint_B(GsfGrid &grid);
 
@@ -89,7 +123,7 @@ private:
 		int digit;
 	};
 	struct TupleList {
-		enum Seen {
+		enum Seen : uint8_t {
 			NoInfo,
 			Solution,
 			Error,
@@ -97,9 +131,9 @@ private:
 		};
 
 		struct SeenMemo {
-			std::vector<Seen> memo;
+			Seen memo[81 * 9];
 
-			SeenMemo() : memo(81 * 9, NoInfo) {}
+			SeenMemo() { std::fill(memo, memo + 81 * 9, NoInfo); }
 
 			Seen get(int cell, int digit) const {
 				return memo[cell * 9 + digit];
@@ -112,10 +146,36 @@ private:
 
 		std::vector<std::vector<TupleEntry> > tuples;
 
-		void init() {
-			tuples.assign(10, std::vector<TupleEntry>());
+		//Kept from the last makeTupleList, which updates them only where the grid changed since then.
+		//possible[cell]: GsfGrid::getCellMask, patterns[d][unit]: cells (indices) of the unit where d is possible.
+		//cellSizes / unitSizes: size of the tuple (0 if not listed), and by size, the bits of the tuples
+		//(cell, and d * 27 + unit), which are in the order of the entries.
+		GsfGrid::Mask possible[81];
+		uint64_t determined[2];
+		GsfGrid::Mask patterns[9][27];
+		uint8_t cellSizes[81];
+		uint8_t unitSizes[9][27];
+		uint64_t cellsBySize[10][2];
+		uint64_t unitsBySize[10][4];
+		//tuples[n] is made from the bits when needed (see list)
+		bool listed[10];
+
+		TupleList() : tuples(10) { clear(); }
+
+		//as if all the cells were determined and had no candidates
+		void clear() {
+			std::fill(possible, possible + 81, 0);
+			std::fill(determined, determined + 2, ~0ULL);
+			std::fill(&patterns[0][0], &patterns[0][0] + 9 * 27, 0);
+			std::fill(cellSizes, cellSizes + 81, 0);
+			std::fill(&unitSizes[0][0], &unitSizes[0][0] + 9 * 27, 0);
+			std::fill(&cellsBySize[0][0], &cellsBySize[0][0] + 10 * 2, 0);
+			std::fill(&unitsBySize[0][0], &unitsBySize[0][0] + 10 * 4, 0);
+			std::fill(listed, listed + 10, false);
 		}
 
+		void list(int n);
+
 		int getNumEntries(int n) const {
 			return (int)tuples[n].size();
 		}
@@ -139,26 +199,117 @@ private:
 				work = 1000LL * iterations / propositions / (solutions + contradictions + 1);
 			return work;
 		}
+
+		void add(const Counters &that) {
+			iterations += that.iterations;
+			propositions += that.propositions;
+			solutions += that.solutions;
+			contradictions += that.contradictions;
+		}
+	};
+
+	struct PropositionResult {
+		Result result;
+		unsigned iterations;
 	};
 
 	int propstep(GsfGrid &grid, TupleList &tupleList, TupleList::SeenMemo &seenMemo, Counters &counters, int w, bool nested);
+	void evaluatePropositions(const GsfGrid &grid, const TupleList &tupleList, const TupleList::SeenMemo &seenMemo, int w);
+	void propstepTuple(const GsfGrid &grid, GsfGrid &movesGrid, TupleList &tupleList, std::vector<TupleList::SeenMemo> &seenMemos, Counters &counters, int m, int w, int i);
 	int constraint_P(GsfGrid &grid);
+	Rater &getWorkerRater(int worker) { return worker == 0 ? *this : *_helpers[worker - 1]; }
 
 	Result propagate(GsfGrid &grid, unsigned &iterations, bool nested);
 
+	void setKnownSolution(const char *solution);
+	bool isKnownSolution(const GsfGrid &grid) const;
+	bool allowsKnownSolution(const GsfGrid &grid) const;
+
 public:
-	Rater(size_t resultMemoSize = 10000) {
-		_resultMemo.init(resultMemoSize);
-	}
+	//intraThreads > 1 evaluates the propositions of constraint_P in parallel (the rating does not change).
+	//memoWays > 1 makes the memo set-associative (see MemoTable::init).
+	Rater(size_t resultMemoSize = 10000, int intraThreads = 1, int memoWays = 1);
 
 	static int squash(long long n);
 	static long long unsquash(int n);
 
 	typedef long long Score;
 	Score rate(const char *problem);
+	Score rateBounded(const char *problem, Score threshold);
+	//Same as rateBounded, for a problem whose solution grid is known (such as a subset of the solution).
+	//The solution only skips checks it decides: the verification of a grid equal to it,
+	//and the check of the units of a grid where every cell can still be its digit.
+	Score rateWithSolution(const char *problem, const char *solution, Score threshold);
+
+	//Undoes the propositions on a grid copied once, instead of copying the grid for each (the rating does not change).
+	//Slower on a single core, as undoing costs more than a copy, but it moves less memory.
+	void setUndoTrail(bool use);
+
+	//Counters of the work done while rating (rate --profile).
+	//Second-level propositions are counted by the width of the first tuple, with the guesses on its entries.
+	struct Profile {
+		long long iterations;
+		long long nakedSingles;
+		long long hiddenSingles;
+		long long boxLineMoves;
+		long long firstLevelPropositions[10];
+		long long secondLevelGuesses[10];
+		long long secondLevelPropositions[10];
+		MemoTableStats memo;
+
+		Profile();
+		void add(const Profile &that);
+		std::string toString() const;
+	};
+	//Counting is off by default, as it costs a little in the hot paths.
+	//getProfile returns the counters since resetProfile (of the helpers for intraThreads too).
+	void setProfiling(bool on);
+	void resetProfile();
+	Profile getProfile() const;
+
+	//uses a memo table shared with other Raters (the helpers for intraThreads too)
+	void shareMemo(SharedMemo *shared);
+	void flushMemoStats();
+	MemoTableStats getMemoStats() const;
 
 private:
+	Score rateGrid(GsfGrid &grid, Score threshold);
+
 	long long _totalWork;
+	long long _workLimit;
 	MemoTable<PropagateResult> _resultMemo;
+	bool _useUndoTrail;
+	//for setProfiling. _profileTupleWidth is the width of the first tuple while in propstepTuple.
+	bool _profiling;
+	Profile _profile;
+	MemoTableStats _profileMemoBase;
+	int _profileTupleWidth;
+	//for rateWithSolution
+	bool _hasSolution;
+	uint8_t _solution[81];
+
+	//for intraThreads > 1. Each worker uses its own Rater (and memo) for nested propagations.
+	std::unique_ptr<WorkerPool> _pool;
+	std::vector<std::unique_ptr<Rater> > _helpers;
+	std::vector<PropositionResult> _propositionResults;
+
+	struct HistoryEntry {
+		GsfGrid::Hash hash;
+		unsigned iterations;
+		long long totalWork;
+	};
+
+	//buffers reused between calls, so that rating does not allocate once they are large enough
+	std::vector<HistoryEntry> _hashHistory;
+	GsfGrid _grid;
+	GsfGrid _propositionGrid, _tupleGrid;
+	//for setUndoTrail
+	UndoTrail _propositionTrail, _tupleTrail;
+	TupleList _tupleList;
+	TupleList::SeenMemo _firstSeenMemo;
+	std::vector<TupleList::SeenMemo> _seenMemos;
+	std::vector<GsfGrid> _movesGrids;
+	std::vector<Counters> _tupleCounters;
+	std::vector<TupleEntry> _propositionEntries;
 };
 
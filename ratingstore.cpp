@@ -0,0 +1,216 @@
+#include "ratingstore.hpp"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#ifndef _WIN32
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+RatingStore::RatingStore(const string &filename) : _filename(filename), _lockFd(-1), _served(0), _added(0) {
+#ifndef _WIN32
+	//a compaction may replace the file while we wait for the lock, and then the new file is locked
+	while(1) {
+		_lockFd = open(filename.c_str(), O_RDONLY | O_CREAT, 0666);
+		if(_lockFd < 0 || flock(_lockFd, LOCK_SH) != 0) {
+			cerr << "can't lock " << filename << endl;
+			abort();
+		}
+		struct stat locked, current;
+		if(fstat(_lockFd, &locked) == 0 && stat(filename.c_str(), &current) == 0
+			&& locked.st_dev == current.st_dev && locked.st_ino == current.st_ino)
+			break;
+		close(_lockFd);
+	}
+#endif
+	_out.open(filename, ios_base::app);
+	if(!_out.is_open()) {
+		cerr << "can't open " << filename << endl;
+		abort();
+	}
+	_in.open(filename);
+	readNewLines();
+}
+
+RatingStore::~RatingStore() {
+#ifndef _WIN32
+	if(_lockFd >= 0)
+		close(_lockFd);
+#endif
+}
+
+bool RatingStore::find(const string &problem, Score &rate) {
+	for(int pass = 0; pass < 2; ++ pass) {
+		if(pass == 1 && !readNewLines())
+			break;
+		lock_guard<mutex> lock(_mutex);
+		auto it = _ratings.find(problem);
+		if(it != _ratings.end()) {
+			rate = it->second;
+			++ _served;
+			return true;
+		}
+	}
+	return false;
+}
+
+void RatingStore::insert(const string &problem, Score rate) {
+	lock_guard<mutex> lock(_mutex);
+	if(!_ratings.emplace(problem, rate).second)
+		return;
+	//one write per line, so that lines of other processes are not mixed in
+	string line = problem + " " + to_string(rate) + "\n";
+	_out.write(line.data(), line.size());
+	_out.flush();
+	++ _added;
+}
+
+size_t RatingStore::size() const {
+	lock_guard<mutex> lock(_mutex);
+	return _ratings.size();
+}
+
+long long RatingStore::getServed() const {
+	lock_guard<mutex> lock(_mutex);
+	return _served;
+}
+
+long long RatingStore::getAdded() const {
+	lock_guard<mutex> lock(_mutex);
+	return _added;
+}
+
+bool RatingStore::readNewLines() {
+	unique_lock<mutex> readLock(_readMutex, try_to_lock);
+	if(!readLock.owns_lock())
+		return false;
+	auto now = chrono::steady_clock::now();
+	if(now < _nextRead)
+		return false;
+	_nextRead = now + chrono::milliseconds(ReadIntervalMilliseconds);
+	_in.clear();
+	streampos start = _in.tellg();
+	_in.seekg(0, ios_base::end);
+	if(_in.tellg() == start)
+		return false;
+	_in.seekg(start);
+	vector<pair<string, Score>> read;
+	string line;
+	while(1) {
+		streampos pos = _in.tellg();
+		if(!getline(_in, line))
+			break;
+		if(_in.eof()) {
+			//unterminated line, which may still be being written
+			_in.clear();
+			_in.seekg(pos);
+			break;
+		}
+		string problem;
+		Score rate;
+		if(parseLine(line, _canonicalizer, problem, rate))
+			read.emplace_back(problem, rate);
+	}
+	lock_guard<mutex> lock(_mutex);
+	for(const auto &p : read)
+		_ratings[p.first] = p.second;
+	return true;
+}
+
+//Lines of rate output without a rating (-1 for problems without a unique solution, or lower bounds such as "2000+")
+//and of problems not in canonical form are skipped, as such ratings are never served.
+bool RatingStore::parseLine(const string &line, const Canonicalizer &canonicalizer, string &problem, Score &rate) {
+	istringstream iss(line);
+	string rateString;
+	if(!(iss >> problem >> rateString) || problem.size() != 81)
+		return false;
+	for(char c : problem) {
+		if(c < '0' || '9' < c)
+			return false;
+	}
+	if(rateString.size() > 18)
+		return false;
+	for(char c : rateString) {
+		if(!isdigit((unsigned char)c))
+			return false;
+	}
+	if(canonicalizer.canonicalizeProblem(problem.c_str()) != problem)
+		return false;
+	rate = stoll(rateString);
+	return true;
+}
+
+//The file is locked exclusively until it is replaced, so that no store opens it meanwhile.
+//The old file is kept as <filename>.bak until the new one is in place.
+bool RatingStore::compact(const string &filename, long long &duplicates, long long &invalid) {
+#ifndef _WIN32
+	int lockFd = open(filename.c_str(), O_RDONLY);
+	if(lockFd < 0) {
+		cerr << "can't open " << filename << endl;
+		abort();
+	}
+	if(flock(lockFd, LOCK_EX | LOCK_NB) != 0) {
+		close(lockFd);
+		return false;
+	}
+#endif
+	Canonicalizer canonicalizer;
+	vector<string> order;
+	unordered_map<string, Score> ratings;
+	long long lines = 0;
+	invalid = 0;
+	{
+		ifstream in(filename);
+		if(!in) {
+			cerr << "can't open " << filename << endl;
+			abort();
+		}
+		string line, problem;
+		Score rate;
+		while(getline(in, line)) {
+			++ lines;
+			if(!parseLine(line, canonicalizer, problem, rate)) {
+				++ invalid;
+				continue;
+			}
+			if(ratings.count(problem) == 0)
+				order.push_back(problem);
+			ratings[problem] = rate;
+		}
+	}
+	string tempFilename = filename + ".tmp";
+	{
+		ofstream out(tempFilename);
+		for(const string &problem : order)
+			out << problem << " " << ratings[problem] << "\n";
+		if(!out) {
+			cerr << "can't write " << tempFilename << endl;
+			abort();
+		}
+	}
+	if(rename(tempFilename.c_str(), filename.c_str()) != 0) {
+		//rename does not replace an existing file on some platforms, and an open file cannot be renamed on Windows
+		string backupFilename = filename + ".bak";
+		remove(backupFilename.c_str());
+		if(rename(filename.c_str(), backupFilename.c_str()) != 0) {
+			remove(tempFilename.c_str());
+			return false;
+		}
+		if(rename(tempFilename.c_str(), filename.c_str()) != 0) {
+			cerr << "can't rename " << tempFilename << " (the store is in " << backupFilename << ")" << endl;
+			abort();
+		}
+		remove(backupFilename.c_str());
+	}
+#ifndef _WIN32
+	close(lockFd);
+#endif
+	duplicates = lines - invalid - (long long)order.size();
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include "canonicalizer.hpp"
+
+//Ratings of canonical problems kept in a file across runs.
+//The file is a list of "<problem> <raw rate>" lines, so the output of rate can be used as is
+//(further columns are ignored, and lines without an exact rating or of a problem not in canonical form are skipped).
+//New ratings are appended. Lines appended by other processes are read when a problem is not found, if the file
+//has grown and the last read is a second (ReadIntervalMilliseconds) ago, by one thread at a time (the others just miss meanwhile).
+//An unterminated last line is left for the next read. Only exact ratings should be inserted.
+//An open store holds a shared lock on the file (flock; on Windows the open file cannot be replaced), so that
+//compact does not replace the file under it. Thread safe.
+class RatingStore {
+public:
+	typedef long long Score;
+
+	explicit RatingStore(const std::string &filename);
+	~RatingStore();
+
+	bool find(const std::string &problem, Score &rate);
+	void insert(const std::string &problem, Score rate);
+
+	size_t size() const;
+	long long getServed() const;
+	long long getAdded() const;
+
+	//Rewrites the file without duplicates and the lines skipped (see above), and sets their numbers.
+	//Returns false without changing the file if a store is open on it.
+	static bool compact(const std::string &filename, long long &duplicates, long long &invalid);
+
+private:
+	enum { ReadIntervalMilliseconds = 1000 };
+
+	//false if no lines were read (see above)
+	bool readNewLines();
+	static bool parseLine(const std::string &line, const Canonicalizer &canonicalizer, std::string &problem, Score &rate);
+
+	std::string _filename;
+	//the descriptor holding the shared lock (-1 if none)
+	int _lockFd;
+	//_mutex guards the ratings and the output, and _readMutex the input
+	mutable std::mutex _mutex;
+	std::mutex _readMutex;
+	std::unordered_map<std::string, Score> _ratings;
+	std::ifstream _in;
+	//for the lines read (guarded by _readMutex)
+	Canonicalizer _canonicalizer;
+	std::chrono::steady_clock::time_point _nextRead;
+	std::ofstream _out;
+	long long _served;
+	long long _added;
+};
@@ -4,6 +4,7 @@
 #include "solver.hpp"
 #include <thread>
 #include <algorithm>
+#include <limits>
 using namespace std;
 
 void SearchWorker::run() {
@@ -18,6 +19,11 @@ void SearchWorker::run() {
 			, "\n  digitCountBounds: [", _config.digitCountBounds.first, ", ", _config.digitCountBounds.second, "]"
 			, "\n  verboseness: ", _config.verboseness
 			, "\n  randomizeSolution: ", _config.randomSolution ? "true" : "false"
+			, "\n  fastRater: ", _config.fastRater ? "true" : "false"
+			, "\n  boundedRating: ", _config.boundedRating ? "true" : "false"
+			, "\n  sharedMemo: ", _config.sharedMemo ? "true" : "false"
+			, "\n  memoWays: ", _config.memoWays
+			, "\n  lockedCandidates: ", _config.lockedCandidates ? "true" : "false"
 			);
 	}
 	_validProblems.assign(_hintMasks.size(), 0);
@@ -57,6 +63,14 @@ void SearchWorker::run() {
 end:
 	if(searches > 0 && _config.verboseness >= 4)
 		sendNumberOfValidProblems();
+	_rater.flushMemoStats();
+	_fastRater.flushMemoStats();
+	if(_config.verboseness >= 4) {
+		//with sharedMemo, the rater counters are in the shared table
+		_infoLogger.log("worker ", _workerID, " memo"
+			, "\n  rater: ", _config.sharedMemo ? "shared" : (_config.fastRater ? _fastRater.getMemoStats() : _rater.getMemoStats()).toString()
+			, "\n  uniqueness checker: ", _searcher.getMemoStats().toString());
+	}
 	ResponceMessage message;
 	message.type = ResponceMessage::Type::WorkerEnded;
 	_outputQueue.enqueue(message);
@@ -68,10 +82,13 @@ void SearchWorker::searchForSolution(const std::string &solution) {
 	_searcher.setSolution(solution.c_str(), _config.uaSize);
 	vector<SymmetrySearcher::SearchResultEntry> result;
 	long long totalValidProblems = 0;
+	long long storedRatings = 0;
+	_preFilter.resetCounters();
 
 	_searcher.searchForSymmetries(_config.digitCountBounds, result);
 
 	string problem;
+	Canonicalizer::GridPermutation permutation;
 	for(const auto &e : result) {
 		++ _validProblems[e.originalMaskIndex];
 		++ totalValidProblems;
@@ -79,19 +96,37 @@ void SearchWorker::searchForSolution(const std::string &solution) {
 		problem.assign(81, '0');
 		for(int pos : e.mask)
 			problem[pos] = solution[pos];
-		problem = _canonicalizer.canonicalizeProblem(problem.c_str());
-		long long rate = _rater.rate(problem.c_str());
+		problem = _canonicalizer.canonicalizeProblem(problem.c_str(), &permutation);
+		if(_preFilter.reject(problem.c_str(), _config.rateThreshold))
+			continue;
+		//with boundedRating, rating stops at rateThreshold and the reported rate is a lower bound
+		long long threshold = _config.boundedRating ? _config.rateThreshold : numeric_limits<long long>::max();
+		long long rate;
+		bool isLowerBound = false;
+		if(_ratingStore != nullptr && _ratingStore->find(problem, rate)) {
+			++ storedRatings;
+		} else {
+			//the solution of the canonical problem is the solution permuted in the same way
+			if(_config.fastRater)
+				rate = _fastRater.rateBounded(problem.c_str(), threshold);
+			else
+				rate = _rater.rateWithSolution(problem.c_str(), permutation.applyTo(solution.c_str()).c_str(), threshold);
+			if(_ratingStore != nullptr && rate < threshold)
+				_ratingStore->insert(problem, rate);
+			isLowerBound = rate >= threshold;
+		}
 		if(_config.rateThreshold <= rate) {
 			ResponceMessage message;
 			message.type = ResponceMessage::Type::FoundProblem;
 			message.problem = problem;
 			message.rate = rate;
+			message.isLowerBound = isLowerBound;
 			_outputQueue.enqueue(message);
 		}
 	}
 
 	if(_config.verboseness >= 4)
-		_infoLogger.log("search for solution ", solution, " ended. ", totalValidProblems, " valid problems found");
+		_infoLogger.log("search for solution ", solution, " ended. ", totalValidProblems, " valid problems found, ", _preFilter.getRejected(), " rejected by prefilter, ", storedRatings, " rated by the store");
 }
 
 void SearchWorker::sendNumberOfValidProblems() {
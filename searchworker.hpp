@@ -6,6 +6,9 @@
 #include "message.hpp"
 #include "masksymmetry.hpp"
 #include "rater.hpp"
+#include "fastrater.hpp"
+#include "prefilter.hpp"
+#include "ratingstore.hpp"
 #include <string>
 
 class SearchWorker {
@@ -13,6 +16,8 @@ private:
 	int _workerID;
 	SymmetrySearcher _searcher;
 	Rater _rater;
+	FastRater _fastRater;
+	RatingPreFilter _preFilter;
 	Canonicalizer _canonicalizer;
 	std::vector<Mask81> _hintMasks;
 	const MaskSymmetry::RowPermutationDiagram *_rowPermutationDiagram;
@@ -20,6 +25,7 @@ private:
 	WorkQueueInterface &_workQueue;
 	ResponceQueueInterface &_outputQueue;
 	Logger &_infoLogger;
+	RatingStore *_ratingStore;
 
 public:
 	SearchWorker(
@@ -31,16 +37,27 @@ public:
 		ResponceQueueInterface &outputQueue,
 		Logger &infoLogger) :
 		_workerID(workerID),
-		_searcher(config.memoSize, infoLogger),
-		_rater(config.memoSize),
+		_searcher(config.memoSize, infoLogger, config.memoWays),
+		_rater(config.fastRater ? 0 : config.memoSize, 1, config.memoWays),
+		_fastRater(config.fastRater ? config.memoSize : 0, config.memoWays),
+		_preFilter(),
 		_canonicalizer(),
 		_hintMasks(hintMasks),
 		_rowPermutationDiagram(rowPermutationDiagram),
 		_config(config),
 		_workQueue(workQueue), _outputQueue(outputQueue),
-		_infoLogger(infoLogger) { }
+		_infoLogger(infoLogger),
+		_ratingStore(nullptr) {
+		_searcher.setLockedCandidates(config.lockedCandidates != 0);
+	}
 
 	void run();
+	void shareMemo(Rater::SharedMemo *raterMemo, FastRater::SharedMemo *fastRaterMemo) {
+		_rater.shareMemo(raterMemo);
+		_fastRater.shareMemo(fastRaterMemo);
+	}
+	//ratings of the (canonical) problems are looked up in and added to the store
+	void setRatingStore(RatingStore *store) { _ratingStore = store; }
 
 private:
 	std::vector<int> _validProblems;
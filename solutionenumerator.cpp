@@ -0,0 +1,89 @@
+#include "solutionenumerator.hpp"
+#include "util.hpp"
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+SolutionEnumerator::SolutionEnumerator(int threads, size_t memoSize) : _pool(threads) {
+	rep(i, _pool.getNumWorkers())
+		_solvers.emplace_back(new FastSolver(memoSize));
+}
+
+//splits all the subproblems at once (breadth first), which keeps them in the order of the search
+void SolutionEnumerator::split(const char *problem) {
+	_tasks.assign(1, string(problem, 81));
+	vector<string> next;
+	while(_tasks.size() < MinTasks) {
+		next.clear();
+		bool splitAny = false;
+		for(const string &task : _tasks) {
+			if(_solvers[0]->splitProblem(task.c_str(), next))
+				splitAny = true;
+			else
+				next.push_back(task);
+		}
+		_tasks.swap(next);
+		if(!splitAny)
+			break;
+	}
+}
+
+template<typename Job, typename Done>
+void SolutionEnumerator::runInOrder(const Job &job, const Done &done) {
+	int numTasks = (int)_tasks.size();
+	vector<bool> finished(numTasks, false);
+	int next = 0;
+	mutex mtx;
+	//tasks are handed out in order, so the ones started after stop are after the tasks passed to done
+	atomic<bool> stop(false);
+	_pool.run(numTasks, [&](int task, int worker) {
+		if(stop.load(memory_order_relaxed))
+			return;
+		job(task, worker);
+		lock_guard<mutex> lock(mtx);
+		finished[task] = true;
+		while(!stop && next < numTasks && finished[next]) {
+			if(!done(next))
+				stop = true;
+			++ next;
+		}
+	});
+}
+
+long long SolutionEnumerator::countSolutions(const char *problem, long long limit) {
+	split(problem);
+	vector<long long> counts(_tasks.size());
+	long long total = 0;
+	runInOrder(
+		[this, &counts, limit](int task, int worker) {
+			counts[task] = _solvers[worker]->countSolutions(_tasks[task].c_str(), limit);
+		},
+		[&counts, &total, limit](int task) {
+			total += min(counts[task], limit - total);
+			return total < limit;
+		});
+	return total;
+}
+
+long long SolutionEnumerator::enumerateSolutions(const char *problem, long long limit, const function<void(const string &)> &output) {
+	split(problem);
+	vector<vector<string> > solutions(_tasks.size());
+	long long total = 0;
+	runInOrder(
+		[this, &solutions, limit](int task, int worker) {
+			_solvers[worker]->enumerateSolutions(_tasks[task].c_str(), limit, solutions[task]);
+		},
+		[&solutions, &total, &output, limit](int task) {
+			for(const string &solution : solutions[task]) {
+				if(total >= limit)
+					break;
+				output(solution);
+				++ total;
+			}
+			vector<string>().swap(solutions[task]);
+			return total < limit;
+		});
+	return total;
+}
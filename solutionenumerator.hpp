@@ -0,0 +1,40 @@
+#pragma once
+#include "fastsolver.hpp"
+#include "workerpool.hpp"
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+
+//Counts or lists all the solutions of a problem with a WorkerPool.
+//The search is split into subproblems (the branches of the first guesses, see FastSolver::splitProblem),
+//which the workers take one by one, so a worker that finishes early takes the rest of the work.
+//The subproblems do not depend on the number of threads, so neither do the results and their order.
+class SolutionEnumerator {
+public:
+	//Each worker has a FastSolver with a memo of memoSize entries.
+	SolutionEnumerator(int threads, size_t memoSize);
+
+	//the number of solutions, or limit if there are limit or more
+	long long countSolutions(const char *problem, long long limit);
+	//Calls output for the first limit solutions in the order of the subproblems, and returns the number of them.
+	//output is called while the workers run (from one of them at a time), as soon as the subproblems before are done.
+	long long enumerateSolutions(const char *problem, long long limit, const std::function<void(const std::string &)> &output);
+
+	//subproblems of the last problem
+	int getNumTasks() const { return (int)_tasks.size(); }
+
+private:
+	//Splits until there are this many subproblems, so that a large one does not keep a worker after the others end.
+	static const size_t MinTasks = 256;
+
+	void split(const char *problem);
+	//calls job(task, worker) for the tasks, and then done(task) in the order of the tasks (under a lock).
+	//Once done returns false, the tasks not started yet are skipped (done is not called for them).
+	template<typename Job, typename Done>
+	void runInOrder(const Job &job, const Done &done);
+
+	WorkerPool _pool;
+	std::vector<std::unique_ptr<FastSolver> > _solvers;
+	std::vector<std::string> _tasks;
+};
@@ -16,6 +16,8 @@ int Solver::solve(const char *problem) {
 int Solver::solveGrid(SolverGrid grid) {
 	_findSolution = false;
 	_randomize = false;
+	_trail.clear();
+	grid.setTrail(_useUndoTrail ? &_trail : nullptr);
 	return dfs(grid);
 }
 
@@ -24,6 +26,8 @@ bool Solver::findSolution(const char *problem, char *solution, bool randomize) {
 	_randomize = randomize;
 	SolverGrid grid;
 	grid.load(problem);
+	_trail.clear();
+	grid.setTrail(_useUndoTrail ? &_trail : nullptr);
 	int solutions = dfs(grid);
 	if(solutions == 0) {
 		rep(cell, 81)
@@ -51,7 +55,6 @@ int Solver::dfs(SolverGrid &grid) {
 			int *p = _resultMemo.find(gridHash);
 			if(p != nullptr) {
 				setResultMemo(*p);
-				grid.init();
 				return *p;
 			}
 			hashHistory.push_back(gridHash);
@@ -74,13 +77,23 @@ int Solver::dfs(SolverGrid &grid) {
 			int solutions = 0;
 			rep(i, result.tupleSize) {
 				auto p = result.smallestTuple[i];
-				SolverGrid copied = grid;
-				copied.assign(p.cell, p.digit);
-				int childSolutions = dfs(copied);
-
-				if(_findSolution && childSolutions > 0) {
-					grid = copied;
-					return 1;
+				int childSolutions;
+				if(_useUndoTrail) {
+					SolverGrid::Checkpoint checkpoint = grid.getCheckpoint();
+					grid.assign(p.cell, p.digit);
+					childSolutions = dfs(grid);
+					//the grid is left solved
+					if(_findSolution && childSolutions > 0)
+						return 1;
+					grid.restore(checkpoint);
+				} else {
+					SolverGrid copied = grid;
+					copied.assign(p.cell, p.digit);
+					childSolutions = dfs(copied);
+					if(_findSolution && childSolutions > 0) {
+						grid = copied;
+						return 1;
+					}
 				}
 
 				solutions += childSolutions;
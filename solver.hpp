@@ -2,16 +2,23 @@
 #include "rater.hpp"
 #include "solvergrid.hpp"
 #include "memotable.hpp"
+#include "undotrail.hpp"
 #include <random>
 
 class Solver {
 	bool _findSolution;
 	bool _randomize;
 	MemoTable<int> _resultMemo;
+	bool _useUndoTrail;
+	UndoTrail _trail;
 	std::default_random_engine _randomEngine;
 
 public:
-	Solver(size_t resultMemoSize = 10000) { _resultMemo.init(resultMemoSize); }
+	Solver(size_t resultMemoSize = 10000) : _useUndoTrail(false) { _resultMemo.init(resultMemoSize); }
+
+	//Undoes the branches of the search instead of copying the grid for each (see SolverGrid::restore).
+	//Slower on a single core, but it moves less memory.
+	void setUndoTrail(bool use) { _useUndoTrail = use; }
 
 	int solve(const char *problem);
 	int solveGrid(SolverGrid grid);
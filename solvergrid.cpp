@@ -15,6 +15,7 @@ void SolverGrid::init() {
 	_invalid = false;
 	initData();
 	_hash = getInitHashCells();
+	_changedUnits = (1U << 27) - 1;
 }
 
 void SolverGrid::load(const char * problem) {
@@ -50,6 +51,8 @@ void SolverGrid::applyMask(int cell, Mask mask) {
 	Mask changed = _cellMasks[cell] & ~mask;
 	if(changed == 0) return;
 
+	if(_trail != nullptr)
+		_trail->push(cell, _cellMasks[cell]);
 	Mask applied;
 	applied = _cellMasks[cell] &= mask;
 
@@ -64,6 +67,7 @@ void SolverGrid::applyMask(int cell, Mask mask) {
 	divmod3(col, stack, blockcol);
 	int blockindex = blockrow * 3 + blockcol;
 	int block = band * 3 + stack;
+	_changedUnits |= 1U << row | 1U << (9 + col) | 1U << (18 + block);
 	for(int d : EachBit(changed)) {
 		_unitMasks[row][d] &= ~(1 << col);
 		_unitMasks[9 + col][d] &= ~(1 << row);
@@ -96,6 +100,30 @@ void SolverGrid::applyMask(int cell, Mask mask) {
 	}
 }
 
+//the unit masks depend only on the cell masks, so the bits of each restored cell are set again
+void SolverGrid::restore(const Checkpoint &checkpoint) {
+	_trail->undo(checkpoint.trailSize, [this](int cell, Mask old) {
+		_cellMasks[cell] = old;
+		int row, col;
+		divmod9(cell, row, col);
+		int band, stack;
+		int blockrow, blockcol;
+		divmod3(row, band, blockrow);
+		divmod3(col, stack, blockcol);
+		int blockindex = blockrow * 3 + blockcol;
+		int block = band * 3 + stack;
+		_changedUnits |= 1U << row | 1U << (9 + col) | 1U << (18 + block);
+		int undetermined = isSingleBitOrZero(old) ? 0 : 1;
+		for(int d : EachBit(old)) {
+			_unitMasks[row][d] = (_unitMasks[row][d] & ~(1 << col)) | undetermined << col;
+			_unitMasks[9 + col][d] = (_unitMasks[9 + col][d] & ~(1 << row)) | undetermined << row;
+			_unitMasks[18 + block][d] = (_unitMasks[18 + block][d] & ~(1 << blockindex)) | undetermined << blockindex;
+		}
+	});
+	_hash = checkpoint.hash;
+	_invalid = checkpoint.invalid;
+}
+
 bool SolverGrid::isDetermined(int cell) const {
 	return isSingleBitOrZero(getCellMask(cell));
 }
@@ -216,9 +244,13 @@ void SolverGrid::makeStep(StepResult &result) {
 		return;
 	}
 
+	//the eliminations change the masks at once, so the units changed meanwhile are checked too
+	uint32_t changedUnits = _changedUnits;
+	_changedUnits = 0;
 	moves += processBoxLineReduction(
 		[this](int unit, int d) { return getUnitMask(unit, d); },
-		[this](int cell, int d) { eliminate(cell, d); }
+		[this](int cell, int d) { eliminate(cell, d); },
+		[this, changedUnits](int unit, int) { return ((changedUnits | _changedUnits) & getBoxLineDependencies(unit)) != 0; }
 	);
 
 	if(moves > 0) {
@@ -1,14 +1,18 @@
 #pragma once
 #include "gridbase.hpp"
+#include "undotrail.hpp"
 
 class SolverGrid : public GridBase {
 	Mask _cellMasks[81];
 	Mask _unitMasks[27][9];
 	bool _invalid;
 	Hash _hash;
+	//units whose masks changed since the last box-line reduction (bit: unit)
+	uint32_t _changedUnits;
+	UndoTrail *_trail;
 
 public:
-	SolverGrid() {}
+	SolverGrid() : _trail(nullptr) {}
 
 	void init();
 	void load(const char *problem);
@@ -26,6 +30,17 @@ public:
 
 	Hash getHash() const { return _hash; }
 
+	//For backtracking in place of copying the grid. While a trail is set, the changes of the cell masks are logged,
+	//and restore undoes the changes made after the checkpoint was taken.
+	struct Checkpoint {
+		size_t trailSize;
+		Hash hash;
+		bool invalid;
+	};
+	void setTrail(UndoTrail *trail) { _trail = trail; }
+	Checkpoint getCheckpoint() const { return Checkpoint{ _trail != nullptr ? _trail->size() : 0, _hash, _invalid }; }
+	void restore(const Checkpoint &checkpoint);
+
 	void debugCheckValidity() const;
 	void debugCheckUnitMasks() const;
 
@@ -51,6 +51,7 @@ void SubsetSearcher::searchForSubsets(std::pair<int, int> numHintsBounds, std::v
 	for(int pos : _maskPoses)
 		_curMask128.set(pos);
 	_depthCount.assign(_superSetSize + 1, 0);
+	_harvestedUASets.clear();
 
 	std::vector<uint64_t> uaSetBuffer(_reducedUASets.size() * (_superSetSize + 1));
 	std::copy(_reducedUASets.begin(), _reducedUASets.end(), uaSetBuffer.begin());
@@ -102,12 +103,28 @@ bool SubsetSearcher::reduceUASets(const Mask81 &superSet) {
 	return true;
 }
 
+//The other solution of a failed check differs in a UA set without clues. Its cells in the superset (a minimal UA set is
+//taken) are kept as a reduced UA set, and the branches that remove all of them are pruned before their checks.
+//They are not added to the UA sets of searchRec, whose buffer is laid out by depth.
+void SubsetSearcher::harvestUASet() {
+	Mask128 difference;
+	if(!_uniquenessChecker.getLastDifference(difference))
+		return;
+	Mask128 uaSet = _uniquenessChecker.minimizeUASet(difference);
+	uint64_t reduced = 0;
+	rep(cell, 81) if(uaSet.get(cell) && _posIndices[cell] >= 0)
+		reduced |= uint64_t(1) << _posIndices[cell];
+	_harvestedUASets.push_back(reduced);
+}
+
 int SubsetSearcher::searchRec(int depth, uint64_t *curUASetsBegin, uint64_t *curUASetsEnd) {
 	++ _depthCount[depth];
 
 	if(depth == _superSetSize - 2 || depth == _superSetSize) {
-		if(!_uniquenessChecker.isSolutionUnique(_curMask128))
+		if(!_uniquenessChecker.isSolutionUnique(_curMask128)) {
+			harvestUASet();
 			return 99;
+		}
 		
 		if(depth == _superSetSize) {
 			char problem[82] = {};
@@ -215,6 +232,15 @@ int SubsetSearcher::searchRec(int depth, uint64_t *curUASetsBegin, uint64_t *cur
 			}
 		}
 
+		if(noEmptyUASet) {
+			for(uint64_t uaSet : _harvestedUASets) {
+				if((uaSet & _remainingMask & ~indexBit) == 0) {
+					noEmptyUASet = false;
+					break;
+				}
+			}
+		}
+
 		if(noEmptyUASet) {
 			_remainingMask &= ~indexBit;
 			_curMask128.unset(_maskPoses[index]);
@@ -18,6 +18,7 @@ public:
 private:
 	bool reduceUASets(const Mask81 &superSet);
 	int searchRec(int depth, uint64_t *curUASetsBegin, uint64_t *curUASetsEnd);
+	void harvestUASet();
 
 	UniquenessChecker _uniquenessChecker;
 	std::vector<Mask81> _uaSets;
@@ -29,6 +30,8 @@ private:
 	std::array<int, 81> _posIndices;
 
 	std::vector<uint64_t> _reducedUASets;
+	//UA sets found by the checks of the current search (reduced to the superset)
+	std::vector<uint64_t> _harvestedUASets;
 
 	int _numHints;
 	uint64_t _prefixMask, _remainingMask, _unvisitedMask;
@@ -17,8 +17,9 @@ using namespace std;
 
 //#include "C:\Dropbox\backup\implements\Util\CPUTime.hpp"
 
-SymmetrySearcher::SymmetrySearcher(size_t memoSize, Logger &infoLogger) :
+SymmetrySearcher::SymmetrySearcher(size_t memoSize, Logger &infoLogger, int memoWays) :
 	_memoSize(memoSize), _infoLogger(infoLogger) {
+	_uniquenessChecker.setMemoWays(memoWays);
 	_columnPermutations.resize(Symmetry::COLUMN_PERMUTATIONS_ORDER);
 	auto generator = Symmetry::allColumnPermutations();
 	copy(generator.begin(), generator.end(), _columnPermutations.begin());
@@ -35,6 +36,7 @@ void SymmetrySearcher::setSolution(const char *solution, int uaSize) {
 		_solution[i] = solution[i];
 	_solution[81] = '\0';
 
+	_memoStats.add(_uniquenessChecker.getMemoStats());
 	_uniquenessChecker.setSolution(_solution, _memoSize);
 
 	UAFinder _uafinder;
@@ -142,6 +144,20 @@ void SymmetrySearcher::addUASet(const Mask81 & mask) {
 		_lastDepthUASets3[lastDepth - 6].emplace_back(maskFirst, maskArray[2]);
 }
 
+//The other solution of a failed check differs in a UA set that no UA set of the lists is in, since the clues hit them all.
+//Its minimal UA set is added to the lists, so that the following masks without a clue in it are pruned before their checks.
+//The lists are not iterated while the search goes deeper, so they can grow here.
+void SymmetrySearcher::harvestUASet() {
+	Mask128 difference;
+	if(!_uniquenessChecker.getLastDifference(difference))
+		return;
+	Mask128 uaSet128 = _uniquenessChecker.minimizeUASet(difference);
+	Mask81 uaSet; uaSet.clear();
+	rep(cell, 81) if(uaSet128.get(cell))
+		uaSet.set(cell);
+	addUASet(uaSet);
+}
+
 void SymmetrySearcher::dfsForRowPermutation(int depth, const MaskSymmetry::RowPermutationDiagram::DiagramNodeOrLeaf *nodeOrLeaf) {
 	if(depth == 9) {
 		Mask128 mask128(0);
@@ -150,8 +166,10 @@ void SymmetrySearcher::dfsForRowPermutation(int depth, const MaskSymmetry::RowPe
 			mask128.set(row * 9 + col);
 		}
 
-		if(!_uniquenessChecker.isSolutionUnique(mask128))
+		if(!_uniquenessChecker.isSolutionUnique(mask128)) {
+			harvestUASet();
 			return;
+		}
 
 		Mask81 mask; mask.clear();
 		rep(depthBand, 3) for(int i : EachBit(_curMaskArray[depthBand])) {
@@ -14,6 +14,7 @@
 class SymmetrySearcher {
 	size_t _memoSize;
 	UniquenessChecker _uniquenessChecker;
+	MemoTableStats _memoStats;
 	std::vector<Mask81> _hintMasks;
 	char _solution[82];
 	std::vector<Mask81> _uaSets;
@@ -25,10 +26,18 @@ class SymmetrySearcher {
 	const MaskSymmetry::RowPermutationDiagram *_rowPermutationDiagram;
 
 public:
-	SymmetrySearcher(size_t memoSize, Logger &infoLogger);
+	SymmetrySearcher(size_t memoSize, Logger &infoLogger, int memoWays = 1);
 
 	void setMasks(const std::vector<Mask81> &masks, const MaskSymmetry::RowPermutationDiagram *rowPermutationDiagram);
 	void setSolution(const char *solution, int uaSize);
+	//see UniquenessChecker::setLockedCandidates
+	void setLockedCandidates(bool use) { _uniquenessChecker.setLockedCandidates(use); }
+	//memo counters of the uniqueness checks for all the solutions so far
+	MemoTableStats getMemoStats() const {
+		MemoTableStats stats = _memoStats;
+		stats.add(_uniquenessChecker.getMemoStats());
+		return stats;
+	}
 
 	struct SearchResultEntry {
 		Mask81 mask;
@@ -39,6 +48,8 @@ public:
 
 private:
 	void addUASet(const Mask81 &mask);
+	//adds a UA set found by the last uniqueness check
+	void harvestUASet();
 
 	void dfsForRowPermutation(int depth, const MaskSymmetry::RowPermutationDiagram::DiagramNodeOrLeaf *nodeOrLeaf);
 
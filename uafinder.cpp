@@ -14,6 +14,8 @@ void UAFinder::findAll(const char *solution, int sizeLimit) {
 	_sizeLimit = sizeLimit;
 	SolverGrid grid;
 	grid.init();
+	_trail.clear();
+	grid.setTrail(_useUndoTrail ? &_trail : nullptr);
 	dfs(grid);
 }
 
@@ -23,12 +25,15 @@ void UAFinder::findForSpecificRegion(const Mask81 &region, int sizeLimit) {
 	grid.init();
 	rep(cell, 81) if(!region.get(cell))
 		grid.applyMask(cell, _solutionMask[cell]);
+	_trail.clear();
+	grid.setTrail(_useUndoTrail ? &_trail : nullptr);
 	dfs(grid);
 }
 
 void UAFinder::init(const char *solution) {
 	SolverGrid::makeSolutionMask(solution, _solutionMask);
 	_uaSets.assign(82, vector<Mask81>());
+	_index.clear();
 	_intersectionMask.clear();
 
 	_sizeLimit = -1;
@@ -59,6 +64,7 @@ void UAFinder::saveTo(std::ostream &os) const {
 
 void UAFinder::loadFrom(std::istream &is) {
 	_uaSets.assign(82, vector<Mask81>());
+	_index.clear();
 	int maxSize;
 	is >> maxSize;
 	for(int size = 0; size <= maxSize; ++ size) {
@@ -73,6 +79,7 @@ void UAFinder::loadFrom(std::istream &is) {
 				mask.set(cell);
 			}
 			_uaSets[size][i] = mask;
+			_index.add(mask);
 		}
 	}
 }
@@ -121,9 +128,16 @@ void UAFinder::dfs(SolverGrid &grid) {
 			}
 			rep(i, size) {
 				auto p = tuple[i];
-				SolverGrid copied = grid;
-				copied.assign(p.cell, p.digit);
-				dfs(copied);
+				if(_useUndoTrail) {
+					SolverGrid::Checkpoint checkpoint = grid.getCheckpoint();
+					grid.assign(p.cell, p.digit);
+					dfs(grid);
+					grid.restore(checkpoint);
+				} else {
+					SolverGrid copied = grid;
+					copied.assign(p.cell, p.digit);
+					dfs(copied);
+				}
 			}
 			return;
 		}
@@ -175,24 +189,23 @@ int UAFinder::checkDifference(const SolverGrid &grid, Mask81 &uaSet, int &uaSize
 	if(uaSize + lowerBound > _sizeLimit)
 		return 99;
 
-	for(int thatSize = 4; thatSize <= uaSize; ++ thatSize) {
-		for(const Mask81 &that : _uaSets[thatSize]) {
-			if(that.isSubsetOf(uaSet))
-				return 99;
-		}
-	}
+	if(_index.containsSubsetOf(uaSet))
+		return 99;
 
 	return difference;
 }
 
+//the stored sets that contain uaSet are no longer minimal, and are removed
 bool UAFinder::addUASet(int size, const Mask81 &uaSet) {
-	_uaSets[size].push_back(uaSet);
-	for(int thatSize = size + 1; thatSize < (int)_uaSets.size(); ++ thatSize) {
-		vector<Mask81> &list = _uaSets[thatSize];
-		list.erase(remove_if(list.begin(), list.end(),
-			[uaSet](const Mask81 &that) {
-			return uaSet.isSubsetOf(that);
-		}), list.end());
+	vector<int> supersets;
+	_index.findSupersetsOf(uaSet, supersets);
+	for(int slot : supersets) {
+		const Mask81 &that = _index.get(slot);
+		vector<Mask81> &list = _uaSets[that.count()];
+		list.erase(find(list.begin(), list.end(), that));
+		_index.remove(slot);
 	}
+	_uaSets[size].push_back(uaSet);
+	_index.add(uaSet);
 	return true;
 }
@@ -2,15 +2,21 @@
 #include "mask81.hpp"
 #include "solver.hpp"
 #include "solvergrid.hpp"
+#include "undotrail.hpp"
+#include "uasetindex.hpp"
 #include <iostream>
 #include <vector>
 
 class UAFinder {
 public:
+  UAFinder() : _useUndoTrail(false) {}
+
   void findAll(const char *solution, int sizeLimit);
   void findForSpecificRegion(const Mask81 &region, int sizeLimit);
 
   void init(const char *solution);
+  //same as Solver::setUndoTrail
+  void setUndoTrail(bool use) { _useUndoTrail = use; }
 
   const std::vector<Mask81> &getList(int size) const {
     return _uaSets[size];
@@ -27,8 +33,12 @@ private:
   SolverGrid::Mask _solutionMask[81];
   Mask81 _intersectionMask;
   std::vector<std::vector<Mask81>> _uaSets;
+  //the sets of _uaSets, for the subset and superset queries
+  UASetIndex _index;
 
   int _sizeLimit;
+  bool _useUndoTrail;
+  UndoTrail _trail;
 
   void dfs(SolverGrid &grid);
 
@@ -0,0 +1,88 @@
+#include "uasetindex.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+void UASetIndex::clear() {
+	_sets.clear();
+	_used.clear();
+	for(auto &v : _cellSlots)
+		v.clear();
+	for(auto &v : _pairSlots)
+		v.clear();
+	_lowerCells.clear();
+	for(auto &m : _higherCells)
+		m.clear();
+}
+
+int UASetIndex::getPairKey(const Mask81 &set) {
+	auto it = set.begin();
+	int first = *it;
+	++ it;
+	assert(it != set.end());
+	return first * 81 + *it;
+}
+
+int UASetIndex::add(const Mask81 &set) {
+	int slot = (int)_sets.size();
+	_sets.push_back(set);
+	if(slot % 64 == 0) {
+		_used.push_back(0);
+		for(auto &v : _cellSlots)
+			v.push_back(0);
+	}
+	uint64_t bit = uint64_t(1) << (slot % 64);
+	_used[slot / 64] |= bit;
+	for(int cell : set)
+		_cellSlots[cell][slot / 64] |= bit;
+	int key = getPairKey(set);
+	_pairSlots[key].push_back(slot);
+	_lowerCells.set(key / 81);
+	_higherCells[key / 81].set(key % 81);
+	return slot;
+}
+
+void UASetIndex::remove(int slot) {
+	const Mask81 &set = _sets[slot];
+	uint64_t bit = uint64_t(1) << (slot % 64);
+	_used[slot / 64] &= ~bit;
+	for(int cell : set)
+		_cellSlots[cell][slot / 64] &= ~bit;
+	int key = getPairKey(set);
+	vector<int> &slots = _pairSlots[key];
+	slots.erase(find(slots.begin(), slots.end(), slot));
+	if(slots.empty()) {
+		Mask81 &higher = _higherCells[key / 81];
+		higher.unset(key % 81);
+		if(higher.count() == 0)
+			_lowerCells.unset(key / 81);
+	}
+}
+
+bool UASetIndex::containsSubsetOf(const Mask81 &mask) const {
+	for(int lower : mask.getIntersection(_lowerCells)) {
+		for(int higher : mask.getIntersection(_higherCells[lower])) {
+			for(int slot : _pairSlots[lower * 81 + higher]) {
+				if(_sets[slot].isSubsetOf(mask))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void UASetIndex::findSupersetsOf(const Mask81 &mask, vector<int> &slots) const {
+	slots.clear();
+	int cells[81], numCells = 0;
+	for(int cell : mask)
+		cells[numCells ++] = cell;
+	rep(w, _used.size()) {
+		uint64_t x = _used[w];
+		for(int k = 0; k < numCells && x != 0; ++ k)
+			x &= _cellSlots[cells[k]][w];
+		for(int bit : EachBit64(x))
+			slots.push_back(w * 64 + bit);
+	}
+}
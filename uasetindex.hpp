@@ -0,0 +1,34 @@
+#pragma once
+#include "mask81.hpp"
+#include <vector>
+#include <cstdint>
+
+//UA sets indexed for the two queries of UAFinder: whether any stored set is a subset of a mask, and which stored sets
+//contain a mask. A set is kept in a slot. The slots are listed by the pair of the two lowest cells of their sets, so that
+//a subset query only tests the sets whose pair is in the mask. For a superset query, the slots of the sets having
+//each cell are kept as a bitset, and those of the cells of the mask are ANDed.
+class UASetIndex {
+public:
+	void clear();
+	//returns the slot of the set (of two or more cells)
+	int add(const Mask81 &set);
+	void remove(int slot);
+	const Mask81 &get(int slot) const { return _sets[slot]; }
+
+	bool containsSubsetOf(const Mask81 &mask) const;
+	//the slots of the stored sets that contain mask, in ascending order
+	void findSupersetsOf(const Mask81 &mask, std::vector<int> &slots) const;
+
+private:
+	static int getPairKey(const Mask81 &set);
+
+	std::vector<Mask81> _sets;
+	//bit slot of the slots in use
+	std::vector<uint64_t> _used;
+	std::vector<uint64_t> _cellSlots[81];
+	//the slots in use by the pair key (the lower cell * 81 + the higher cell), with the pairs that have slots:
+	//the lower cells, and the higher cells of each lower cell
+	std::vector<int> _pairSlots[81 * 81];
+	Mask81 _lowerCells;
+	Mask81 _higherCells[81];
+};
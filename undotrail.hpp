@@ -0,0 +1,35 @@
+#pragma once
+#include "gridbase.hpp"
+#include <vector>
+#include <cstdint>
+
+//Log of the masks a grid changes, for backtracking without copying the grid.
+//An entry has the old mask of a cell (index < 81) or a unit (index 81 + unit).
+//The grid derives the rest of its state (unit masks of digits etc.) from these when undoing.
+class UndoTrail {
+public:
+	typedef GridBase::Mask Mask;
+
+	struct Entry {
+		uint8_t index;
+		Mask old;
+	};
+
+	size_t size() const { return _entries.size(); }
+	void clear() { _entries.clear(); }
+
+	void push(int index, Mask old) { _entries.push_back(Entry{ (uint8_t)index, old }); }
+
+	//calls restore(index, old) for the entries after the first size entries, from the newest one
+	template<typename Restore>
+	void undo(size_t size, Restore restore) {
+		while(_entries.size() > size) {
+			const Entry &e = _entries.back();
+			restore(e.index, e.old);
+			_entries.pop_back();
+		}
+	}
+
+private:
+	std::vector<Entry> _entries;
+};
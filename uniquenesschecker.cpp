@@ -13,6 +13,10 @@
 UniquenessChecker::UniquenessChecker() {
 	FastGrid::initMasks();
 	_hasOriginalSolution = false;
+	_memoWays = 1;
+	_lockedCandidates = false;
+	_hasLastDifference = false;
+	_lastDifference = Mask128(0);
 }
 
 void UniquenessChecker::setSolution(const char *solution, size_t memoSize) {
@@ -22,12 +26,17 @@ void UniquenessChecker::setSolution(const char *solution, size_t memoSize) {
 		_originalSolution[i] = solution[i] - '1';
 	}
 	_hasOriginalSolution = true;
-	_memoTable.init(memoSize);
+	_memoTable.init(memoSize, _memoWays);
 }
 
 void UniquenessChecker::unsetSolution(size_t memoSize) {
 	_hasOriginalSolution = false;
-	_memoTable.init(memoSize);
+	_memoTable.init(memoSize, _memoWays);
+}
+
+void UniquenessChecker::shareMemo(SharedMemo *shared) {
+	assert(!_hasOriginalSolution);
+	_memoTable.share(shared);
 }
 
 bool UniquenessChecker::isSolutionUnique(Mask128 mask) {
@@ -38,11 +47,50 @@ bool UniquenessChecker::isSolutionUnique(Mask128 mask) {
 		assignDigit(cell, _originalSolution[cell], state);
 		mask ^= lb;
 	}
+	_hasLastDifference = false;
 	return checkRec(state) == 1;
 }
 
+//Without the clues of uaSet, the problem has another solution, which differs from the solution only in uaSet.
+//A cell is removed from the set if the problem still has another solution without it, and the set becomes the
+//difference of that solution when it is known. The set left is a UA set which has no smaller UA set in it.
+//The clues outside the set are assigned once, so that each check assigns one more.
+Mask128 UniquenessChecker::minimizeUASet(Mask128 uaSet) {
+	assert(_hasOriginalSolution);
+	CheckState outside;
+	assignClues(FastGrid::mask81 & ~uaSet, outside);
+	Mask128 rest = uaSet;
+	while(rest) {
+		Mask128 lb = rest.getLowestBit();
+		rest ^= lb;
+		CheckState state = outside;
+		assignClues(lb, state);
+		_hasLastDifference = false;
+		if(checkRec(state) != 1) {
+			Mask128 difference;
+			Mask128 smaller = getLastDifference(difference) ? difference : uaSet ^ lb;
+			assignClues(uaSet & ~smaller, outside);
+			uaSet = smaller;
+			rest &= uaSet;
+		}
+	}
+	_hasLastDifference = false;
+	return uaSet;
+}
+
+void UniquenessChecker::assignClues(Mask128 mask, CheckState &state) const {
+	while(mask) {
+		Mask128 lb = mask.getLowestBit();
+		int cell = lb.getBitPos();
+		if(state.solvedDigits[cell] == uint8_t(-1))
+			assignDigit(cell, _originalSolution[cell], state);
+		mask ^= lb;
+	}
+}
+
 int UniquenessChecker::countSolutions(const char *problem) {
 	CheckState state{};
+	_hasLastDifference = false;
 	for(int cell = 0; cell < 81; ++ cell) {
 		if(auto d = parseHint(problem[cell])) {
 			assignDigit(cell, d.get(), state);
@@ -83,14 +131,47 @@ int UniquenessChecker::checkRec(CheckState &state) {
 		} else if(_hasOriginalSolution) {
 			bool isDifferent = std::memcmp(state.solvedDigits, _originalSolution, sizeof state.solvedDigits) != 0;
 			result = isDifferent ? 2 : 1;
+			if(isDifferent && !_hasLastDifference) {
+				_lastDifference = Mask128(0);
+				for(int cell = 0; cell < 81; ++ cell) if(state.solvedDigits[cell] != _originalSolution[cell])
+					_lastDifference.set(cell);
+				_hasLastDifference = true;
+			}
 		} else {
 			result = 1;
 		}
 		return setResultMemo(result);
 	}
 
-	int minSize = 10;
+	if(_lockedCandidates && resolveLockedCandidates(state) != 0)
+		return setResultMemo(checkRec(state));
+
 	std::pair<int, int> minTuple[9];
+	int minSize = findMinTuple(state, minTuple);
+
+	int differentBranches = 0;
+	for(int k = 0; k < minSize; ++ k) {
+		const auto &p = minTuple[k];
+		if(_originalSolution[p.first] != p.second)
+			std::swap(minTuple[differentBranches ++], minTuple[k]);
+	}
+
+	int total = 0;
+	for(int k = 0; k < minSize; ++ k) {
+		int cell = minTuple[k].first, digit = minTuple[k].second;
+
+		CheckState childState = state;
+		assignDigit(cell, digit, childState);
+		total += checkRec(childState);
+		if(total >= 2)
+			return setResultMemo(total);
+	}
+
+	return setResultMemo(total);
+}
+
+int UniquenessChecker::findMinTuple(const CheckState &state, std::pair<int, int> *minTuple) {
+	int minSize = 10;
 
 	{
 		Mask128 cntx1 = state.grid.digitMasks[0], cntx2(0), cntx4(0);
@@ -135,26 +216,7 @@ int UniquenessChecker::checkRec(CheckState &state) {
 
 endFindingMinTuple:
 	assert(2 <= minSize && minSize <= 9);
-
-	int differentBranches = 0;
-	for(int k = 0; k < minSize; ++ k) {
-		const auto &p = minTuple[k];
-		if(_originalSolution[p.first] != p.second)
-			std::swap(minTuple[differentBranches ++], minTuple[k]);
-	}
-
-	int total = 0;
-	for(int k = 0; k < minSize; ++ k) {
-		int cell = minTuple[k].first, digit = minTuple[k].second;
-
-		CheckState childState = state;
-		assignDigit(cell, digit, childState);
-		total += checkRec(childState);
-		if(total >= 2)
-			return setResultMemo(total);
-	}
-
-	return setResultMemo(total);
+	return minSize;
 }
 
 int UniquenessChecker::resolveSolvedSquares(CheckState &state) {
@@ -249,7 +311,37 @@ int UniquenessChecker::resolveHiddenSingles(CheckState &state) {
 	return flag;
 }
 
-int UniquenessChecker::checkStatus(CheckState &state) {
+int UniquenessChecker::resolveLockedCandidates(CheckState &state) {
+	int flag = 0;
+	for(int d = 0; d < 9; ++ d) {
+		Mask128 &digitMask = state.grid.digitMasks[d];
+		if(!digitMask) continue;
+		//each line and the 3 boxes it crosses
+		for(int line = 0; line < 18; ++ line) {
+			const Mask128 &lineMask = FastGrid::unitMasks[line];
+			Mask128 lineCandidates = digitMask & lineMask;
+			if(!lineCandidates) continue;
+			for(int k = 0; k < 3; ++ k) {
+				int box = line < 9 ? line / 3 * 3 + k : k * 3 + (line - 9) / 3;
+				const Mask128 &boxMask = FastGrid::unitMasks[18 + box];
+				Mask128 boxCandidates = digitMask & boxMask;
+				Mask128 eliminated(0);
+				if(lineCandidates && !(lineCandidates & ~boxMask))
+					eliminated = boxCandidates & ~lineMask;
+				else if(boxCandidates && !(boxCandidates & ~lineMask))
+					eliminated = lineCandidates & ~boxMask;
+				if(eliminated) {
+					digitMask ^= eliminated;
+					lineCandidates = digitMask & lineMask;
+					flag = 1;
+				}
+			}
+		}
+	}
+	return flag;
+}
+
+int UniquenessChecker::checkStatus(const CheckState &state) {
 	Mask128 unassigned = state.grid.getUnassignedMask();
 	int count = 0;
 	for(int cell = 0; cell < 81; ++ cell) {
@@ -5,10 +5,11 @@
 #include <cstdint>
 #include <mutex>
 #include <cstring>
+#include <utility>
 
 class UniquenessChecker {
-private:
-
+public:
+	//also used by FastSolver
 	struct CheckState {
 		FastGrid grid;
 		uint8_t solvedDigits[81];
@@ -22,26 +23,58 @@ private:
 
 		uint64_t computeHash() const { return grid.computeHash() ^ solvedDigitsHash; }
 	};
-public:
+
+	//The steps of the search, which do not depend on the checker (FastSolver uses them too).
+	//resolveSolvedSquares / resolveHiddenSingles return 1 if they assigned digits.
+	//checkStatus returns the number of unassigned cells, or -1 if one of them has no candidates.
+	//findMinTuple stores the candidates (cell, digit) of a smallest tuple (at least 2) and returns its size.
+	static int resolveSolvedSquares(CheckState &state);
+	static int resolveHiddenSingles(CheckState &state);
+	//box-line reduction (locked candidates). Returns 1 if it eliminated candidates, which may leave a cell without candidates.
+	static int resolveLockedCandidates(CheckState &state);
+	static int checkStatus(const CheckState &state);
+	static int assignDigit(int cell, int digit, CheckState &state);
+	static int findMinTuple(const CheckState &state, std::pair<int, int> *minTuple);
+
+	typedef ConcurrentMemoTable<int> SharedMemo;
 
 	UniquenessChecker();
 
 	void setSolution(const char *solution, size_t memoSize = 1 << 16);
 	void unsetSolution(size_t memoSize = 1 << 16);
+	//Uses a memo table shared with other checkers. Only without a solution, since the results depend on it.
+	//setSolution / unsetSolution go back to a private table.
+	void shareMemo(SharedMemo *shared);
+	void flushMemoStats() { _memoTable.flushStats(); }
+	//for the tables made by the following setSolution / unsetSolution (see MemoTable::init)
+	void setMemoWays(int ways) { _memoWays = ways; }
+	//counters since the last setSolution / unsetSolution
+	MemoTableStats getMemoStats() const { return _memoTable.getStats(); }
+	//Applies box-line reduction (resolveLockedCandidates) before guessing, as FastSolver does. Fewer nodes, same results.
+	void setLockedCandidates(bool use) { _lockedCandidates = use; }
 
 	bool isSolutionUnique(Mask128 mask);
+	//The cells where the other solution found by the last check differs from the solution (they form a UA set).
+	//False if the last check found no other solution itself (unique, or the result came from the memo).
+	bool getLastDifference(Mask128 &difference) const {
+		difference = _lastDifference;
+		return _hasLastDifference;
+	}
+	//Shrinks a UA set of the solution (such as a difference above) to a minimal one in it, with a check per cell.
+	Mask128 minimizeUASet(Mask128 uaSet);
 
 	int countSolutions(const char *problem);
 
 private:
 	int checkRec(CheckState &state);
-	int resolveSolvedSquares(CheckState &state);
-	int resolveHiddenSingles(CheckState &state);
-	int checkStatus(CheckState &state);
-
-	int assignDigit(int cell, int digit, CheckState &state);
+	//assigns the digits of the solution in mask to the cells not assigned yet
+	void assignClues(Mask128 mask, CheckState &state) const;
 
 	bool _hasOriginalSolution;
 	uint8_t _originalSolution[81];
+	int _memoWays;
+	bool _lockedCandidates;
 	MemoTable<int> _memoTable;
+	bool _hasLastDifference;
+	Mask128 _lastDifference;
 };
@@ -54,6 +54,15 @@ inline int countOneBits64(unsigned long long x) {
 #endif
 }
 
+//a hint to load the cache line of p, for a read soon
+inline void prefetchForRead(const void *p) {
+#ifdef __GNUC__
+	__builtin_prefetch(p);
+#else
+	_mm_prefetch((const char *)p, _MM_HINT_T0);
+#endif
+}
+
 inline bool isSingleBitOrZero(unsigned x) {
 	return (x & (x - 1)) == 0;
 }
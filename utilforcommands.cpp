@@ -14,18 +14,54 @@ void help(string message) {
 	cerr << R"(
 smr <command> <options>
 
-smr rate [--memosize=<size>] [--nocheck] [--threads=<num>]
+smr rate [--memosize=<size>] [--store=<filename>] [--nocheck] [--threads=<num>] [--intra-threads=<num>] [--sharedmemo] [--memoways=<ways>] [--memostats] [--allocations] [--fastrater] [--threshold=<raw rate>] [--undotrail] [--profile] [--fastsolver] [--batchsolver]
 	Rate problems
 	nocheck: do not check if a problem has multiple solutions
-
-smr solve [--memosize=<size>] [--nocheck] [--randomize]
+	intra-threads: rate each problem with this many threads (same ratings; not with --fastrater)
+	sharedmemo: share one memo table among the threads
+	memoways: make the memo table set-associative with this many entries per bucket (1: direct-mapped)
+	memostats: print memo table counters (lookups, hits, evictions) to stderr
+	allocations: print the number of heap allocations while rating to stderr (needs "make alloc"; not with --threads)
+	fastrater: use the bitboard rater (same ratings)
+	threshold: stop rating at this raw rate; such ratings are printed as lower bounds with '+'
+	store: reuse and save the ratings of canonical problems in this file (the output of rate can be used;
+	  problems are looked up after the uniqueness check, and the store is not used with --nocheck)
+	undotrail: undo the propositions on a grid instead of copying the grid for each (same ratings; not with --fastrater)
+	profile: print to stderr the time and the work of each rating (iterations, moves of the techniques, propositions by tuple width, memo lookups)
+	  and their sum (not with --fastrater)
+	fastsolver: check the uniqueness with the bitboard solver (same results)
+	batchsolver: check the uniqueness of batches of problems with the multi-lane solver before rating them (same results;
+	  without --threads, the output of a batch comes after it is read)
+
+smr neighbours [--memosize=<size>] [--threshold=<raw rate>]
+	Rate problems and their neighbours (each clue removed, each empty cell filled with the solution), in the output format of rate
+
+smr solve [--memosize=<size>] [--nocheck] [--randomize] [--undotrail] [--fastsolver | --dlx | --batchsolver] [--limit=<num>] [--benchmark] [--count | --all] [--threads=<num>]
 	Solve problems
 	nocheck: do not check if a problem has multiple solutions
 	randomize: randomize the solution search
-
-smr finduasets [--size=<size>]
+	undotrail: undo the branches of the search instead of copying the grid for each (same results)
+	fastsolver: use the bitboard solver (same numbers of solutions; a problem with two or more may get another solution)
+	dlx: use the dancing links solver (same numbers of solutions; a problem with two or more may get another solution)
+	batchsolver: solve batches of problems with the multi-lane solver, several problems at a time (same numbers of solutions; not with --nocheck, --randomize, --undotrail)
+	limit: count the solutions up to this number (default: 2, which means two or more; needs --fastsolver, --dlx or --batchsolver)
+	benchmark: solve the problems with the other solvers too (FastSolver with --batchsolver), and print the times and the mismatches to stderr
+	  (also checks that FastSolver gives the same counts with the limits 2 and --limit, one after the other)
+	count: print the number of solutions of each problem (up to --limit if given, with '+' if it reaches it)
+	all: print all the solutions (the first --limit ones if given), and their number to stderr
+	threads: count or list the solutions with this many threads (same results in the same order; not with --dlx)
+
+smr finduasets [--size=<size>] [--undotrail]
 	Find unavoidable sets
 	size: upper bound of UA set size
+	undotrail: same as solve
+
+smr checkbench [--clues=<num>] [--masks=<num>] [--interleave=<num>] [--memosizes=<size>,<size>,...]
+	Time the uniqueness checks of random clue masks of the solutions, one at a time and interleaved, for each memo size
+	clues: number of clues of each mask (default: 26)
+	masks: number of masks per solution (default: 1000)
+	interleave: number of checks run together (default: 8)
+	memosizes: memo sizes to try (default: 65536,1048576,4194304)
 
 smr printsymmetries
 	Print symmetries
@@ -38,9 +74,17 @@ smr canonicalize <mask|solution|problem|naive> [--permutation]
 	naive: canonicalize arbitrary strings of length 81
 	permutation: show permutation
 
-smr combine [--problems=<filename>] [--masks=<filename>] [--solutions=<filename | RANDOM>] [--output=<filename>] [--threshold=<raw rate>] [--uasize=<size>] [--memosize=<size>] [--workers=<number of threads>] [--dclb=<digit count lower bound>] [--dcub=<digit count upper bound>] [--verboseness=<level>]
+smr combine [--problems=<filename>] [--masks=<filename>] [--solutions=<filename | RANDOM>] [--output=<filename>] [--threshold=<raw rate>] [--uasize=<size>] [--memosize=<size>] [--workers=<number of threads>] [--dclb=<digit count lower bound>] [--dcub=<digit count upper bound>] [--verboseness=<level>] [--fastrater] [--bounded] [--sharedmemo] [--memoways=<ways>] [--lockedcandidates] [--fastsolver | --batchsolver] [--store=<filename>]
 	Search combined problems
 	problems=<filename>: same as --masks=<filename> --solutions=<filename>
+	fastrater: use the bitboard rater (same ratings)
+	bounded: stop rating at the threshold (such rates are lower bounds, and are written with '+')
+	sharedmemo: share one rater memo table among the worker threads (not with MPI)
+	memoways: entries per bucket of the memo tables (1: direct-mapped); the counters are logged with --verboseness=4
+	lockedcandidates: apply box-line reduction in the uniqueness checks of the candidates (same results)
+	fastsolver: solve the problems of --solutions with the bitboard solver
+	batchsolver: solve the problems of --solutions with the multi-lane solver
+	store: reuse and save the ratings in this file (not with MPI)
 
 smr squash
 	Calculate squashed rating and inverse of that
@@ -59,6 +103,9 @@ smr commonmask
 		000000001000002340003010250001005004060000700800900000002004003070080000900600000
 		000000001000002340003000250001005604060070000800600000002004005090800000700090000
 
+smr compactstore <filename>
+	Remove duplicated ratings and invalid lines from a rating store file (refused while rate, combine or fullsearch has the file open)
+
 smr uastatistics [--size=<ua set size>] [--threads=<num of threads>] [--interval=<output interval>]
 )";
 	exit(1);
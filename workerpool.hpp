@@ -0,0 +1,101 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+//Fixed set of threads for parallel-for style jobs.
+//The calling thread takes part in each job as worker 0.
+//Jobs are called through a plain function pointer (not std::function), so running a job does not allocate.
+class WorkerPool {
+public:
+	explicit WorkerPool(int numWorkers) :
+		_job(nullptr), _jobContext(nullptr), _numTasks(0), _nextTask(0), _generation(0), _running(0), _quit(false) {
+		for(int worker = 1; worker < numWorkers; ++ worker)
+			_threads.emplace_back([this, worker]() { workerMain(worker); });
+	}
+
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_cvStart.notify_all();
+		for(auto &t : _threads)
+			t.join();
+	}
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator=(const WorkerPool &) = delete;
+
+	int getNumWorkers() const { return (int)_threads.size() + 1; }
+
+	//calls job(task, worker) for every task in [0, numTasks) and waits for all of them.
+	//Tasks are handed out dynamically, so results have to be stored per task.
+	template<typename Job>
+	void run(int numTasks, const Job &job) {
+		if(numTasks <= 1 || _threads.empty()) {
+			for(int task = 0; task < numTasks; ++ task)
+				job(task, 0);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_job = &callJob<Job>;
+			_jobContext = &job;
+			_numTasks = numTasks;
+			_nextTask = 0;
+			_running = (int)_threads.size();
+			++ _generation;
+		}
+		_cvStart.notify_all();
+		work(0);
+		std::unique_lock<std::mutex> lock(_mutex);
+		_cvFinish.wait(lock, [this]() { return _running == 0; });
+		_job = nullptr;
+		_jobContext = nullptr;
+	}
+
+private:
+	template<typename Job>
+	static void callJob(const void *job, int task, int worker) {
+		(*static_cast<const Job *>(job))(task, worker);
+	}
+
+	void workerMain(int worker) {
+		unsigned generation = 0;
+		while(1) {
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_cvStart.wait(lock, [this, generation]() { return _quit || _generation != generation; });
+				if(_quit)
+					return;
+				generation = _generation;
+			}
+			work(worker);
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if(-- _running == 0)
+					_cvFinish.notify_one();
+			}
+		}
+	}
+
+	void work(int worker) {
+		int task;
+		while((task = _nextTask ++) < _numTasks)
+			_job(_jobContext, task, worker);
+	}
+
+	std::vector<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _cvStart, _cvFinish;
+	void (*_job)(const void *job, int task, int worker);
+	const void *_jobContext;
+	int _numTasks;
+	std::atomic<int> _nextTask;
+	unsigned _generation;
+	int _running;
+	bool _quit;
+};